@@ -0,0 +1,271 @@
+/* bench.c - on-target microbenchmarks for dtekv-lib.c and timetemplate.S
+   Build with "make bench" and run main.bin on the board or on any RV32IM
+   simulator that maps the JTAG UART. Only polled output, no wfi, and the only
+   interrupt is the timer one of the latency benchmark at the end.
+   Every primitive is run many times under mcycle and the average cycles per
+   call are printed, with the cost of the empty benchmark call subtracted. */
+
+#include "dtekv-lib.h"
+#include "parser.h"
+#include "timer.h"
+
+#define BENCH_ROUNDS        2000   /* compute-only primitives */
+#define BENCH_PRINT_ROUNDS  1000   /* primitives that produce UART output */
+#define BENCH_PARSE_ROUNDS  200    /* times the parser script is fed through */
+#define BENCH_IRQS          256    /* timer interrupts timed by the latency benchmark */
+#define BENCH_IRQ_PERIOD_US 100
+
+/* Interrupt latency: the timer interrupts every BENCH_IRQ_PERIOD_US while main
+   spins, and the first thing the handler does is read how long ago the
+   timeout was (timer_since_timeout). That is the way from the timeout into C:
+   taking the trap, the vector slot and the register saves in boot.S.
+   "make bench ISR_FULL_SAVE=1" builds the old entry that saves everything. */
+static volatile unsigned irq_count;
+static unsigned irq_min = ~0u, irq_max, irq_sum;
+
+static void latency_isr(unsigned cause)
+{
+  (void) cause;
+  unsigned latency = timer_since_timeout();
+  timer_isr();
+  if (irq_count == BENCH_IRQS)
+    return;
+  if (latency < irq_min) irq_min = latency;
+  if (latency > irq_max) irq_max = latency;
+  irq_sum += latency;
+  irq_count++;
+}
+
+static volatile int sink;          /* results go here so nothing is optimized away */
+static int bench_time = 0x5957;
+static char bench_str[16] __attribute__((aligned(4)));
+
+/* The print_dec algorithm before the digit-pair rewrite, writing into a buffer:
+   used as the reference for the cross-check and as the "before" number. */
+static unsigned legacy_format_dec(char *buf, unsigned x)
+{
+  unsigned divident = 1000000000;
+  unsigned n = 0;
+  char first = 0;
+  do {
+    int dv = x / divident;
+    if (dv != 0) first = 1;
+    if (first != 0)
+      buf[n++] = 48 + dv;
+    x -= dv*divident;
+    divident /= 10;
+  } while (divident != 0);
+  if (first == 0)
+    buf[n++] = 48;
+  return n;
+}
+
+static int same_dec(unsigned x)
+{
+  char a[16], b[16];
+  unsigned na = format_dec(a, x);
+  unsigned nb = legacy_format_dec(b, x);
+  if (na != nb) return 0;
+  for (unsigned i = 0; i < na; i++)
+    if (a[i] != b[i]) return 0;
+  return 1;
+}
+
+/* Cross-check format_dec (used by print_dec and its variants) against the old
+   routine: 0..99999 exhaustively, every power of ten +-2, the top of the range
+   and a stride sweep over all 32-bit values. Returns the number of mismatches. */
+static unsigned check_print_dec(unsigned *checked)
+{
+  unsigned bad = 0, n = 0, x;
+
+  for (x = 0; x < 100000; x++, n++)
+    if (!same_dec(x)) bad++;
+  for (unsigned p = 10; p <= 1000000000u; p *= 10)
+    for (x = p - 2; x != p + 3; x++, n++)
+      if (!same_dec(x)) bad++;
+  for (x = 0xffffffffu; x > 0xfffffff0u; x--, n++)
+    if (!same_dec(x)) bad++;
+  for (unsigned i = 0; i < 200000; i++, n++)
+    if (!same_dec(i * 21473u + (i >> 3) * 2654435761u)) bad++;
+
+  *checked = n;
+  return bad;
+}
+
+static void b_empty(unsigned i)       { (void) i; }
+static void b_printc(unsigned i)      { printc('a' + (i & 15)); }
+static void b_print(unsigned i)       { (void) i; print("bench "); }
+static void b_print_dec(unsigned i)   { print_dec(i * 2654435761u); printc(' '); }
+static void b_print_hex32(unsigned i) { print_hex32(i * 2654435761u); printc(' '); }
+static void b_nextprime(unsigned i)   { sink = nextprime(1000 + (i & 255)); }
+static void b_tick(unsigned i)        { (void) i; tick(&bench_time); }
+static void b_time2string(unsigned i) { time2string(bench_str, 0x5900 + (i & 0x59)); }
+static void b_hexasc(unsigned i)      { sink = hexasc(i); }
+static void b_delay0(unsigned i)      { (void) i; delay(0); }
+/* print_hex32 digits, the old nibble loop vs two hexasc4 calls */
+static void b_hex_old(unsigned i)
+{
+  unsigned x = i * 2654435761u;
+  for (int k = 7; k >= 0; k--) {
+    char hd = (char) ((x >> (k*4)) & 0xf);
+    bench_str[7 - k] = hd < 10 ? hd + '0' : hd + ('A' - 10);
+  }
+}
+static void b_hex_swar(unsigned i)
+{
+  unsigned x = i * 2654435761u;
+  ((unsigned*) bench_str)[0] = hexasc4(x >> 16);
+  ((unsigned*) bench_str)[1] = hexasc4(x & 0xffff);
+}
+/* time2string as it was: one hexasc call and byte store per digit */
+static void b_t2s_old(unsigned i)
+{
+  unsigned t = 0x5900 + (i & 0x59);
+  bench_str[0] = hexasc(t >> 12);
+  bench_str[1] = hexasc(t >> 8);
+  bench_str[2] = ':';
+  bench_str[3] = hexasc(t >> 4);
+  bench_str[4] = hexasc(t);
+  bench_str[5] = 0;
+}
+static void b_fmt_dec(unsigned i)     { sink = format_dec(bench_str, i * 2654435761u); }
+static void b_fmt_dec_old(unsigned i) { sink = legacy_format_dec(bench_str, i * 2654435761u); }
+
+/* Typed-command stream for the parser benchmark: a full game's worth of
+   commands in mixed spelling, plus the odd unknown word and bad command. */
+static const char parse_script[] =
+  "go north\r\nTake the Flashlight\nn\nnorth\ntake silver key\ni\n"
+  "s\ns\ne\nuse torch\nwalk south\nlook\nN\ne\nuse the silver key\n"
+  "e\nget brass key\nw\nw\ns\nxyzzy\ninventory\ngo flashlight\n"
+  "west\nuse brass key\ngo west\n";
+
+/* Feeds parse_script through the line buffer and the parser, like
+   parser_poll does with received characters. Returns the mcycle count;
+   *commands gets the lines that parsed to a command, *errors the rest. */
+static unsigned bench_parser(unsigned *commands, unsigned *errors)
+{
+  struct lstr word;
+  unsigned ok = 0, bad = 0;
+  unsigned t0 = read_mcycle();
+
+  for (unsigned r = 0; r < BENCH_PARSE_ROUNDS; r++) {
+    for (const char *c = parse_script; *c != '\0'; c++) {
+      if (!parser_feed(*c))
+        continue;
+      unsigned len;
+      const char *line = parser_line(&len);
+      int code = parse_command(line, len, &word);
+      if (code >= 0) {
+        sink = code;
+        ok++;
+      } else if (code != PARSE_EMPTY) {
+        bad++;
+      }
+    }
+  }
+  unsigned t = read_mcycle() - t0;
+  *commands = ok;
+  *errors = bad;
+  return t;
+}
+
+struct bench {
+  const char *name;
+  void (*fn)(unsigned);
+  unsigned rounds;
+};
+
+static const struct bench benches[] = {
+  { "printc      ", b_printc,      BENCH_PRINT_ROUNDS },
+  { "print       ", b_print,       BENCH_PRINT_ROUNDS },
+  { "print_dec   ", b_print_dec,   BENCH_PRINT_ROUNDS },
+  { "print_hex32 ", b_print_hex32, BENCH_PRINT_ROUNDS },
+  { "nextprime   ", b_nextprime,   BENCH_ROUNDS },
+  { "tick        ", b_tick,        BENCH_ROUNDS },
+  { "time2string ", b_time2string, BENCH_ROUNDS },
+  { "t2s old     ", b_t2s_old,     BENCH_ROUNDS },
+  { "hexasc      ", b_hexasc,      BENCH_ROUNDS },
+  { "delay(0)    ", b_delay0,      BENCH_ROUNDS },
+  { "format_dec  ", b_fmt_dec,     BENCH_ROUNDS },
+  { "fmt_dec old ", b_fmt_dec_old, BENCH_ROUNDS },
+  { "hex8 swar   ", b_hex_swar,    BENCH_ROUNDS },
+  { "hex8 old    ", b_hex_old,     BENCH_ROUNDS },
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+static unsigned run(void (*fn)(unsigned), unsigned rounds)
+{
+  unsigned t0 = read_mcycle();
+  for (unsigned i = 0; i < rounds; i++)
+    fn(i);
+  return read_mcycle() - t0;
+}
+
+/* Average cycles per call, minus the call/loop overhead measured with b_empty. */
+static unsigned per_call(unsigned cycles, unsigned rounds, unsigned overhead)
+{
+  unsigned c = cycles / rounds;
+  return c > overhead ? c - overhead : 0;
+}
+
+int main(void)
+{
+  unsigned results[NUM_BENCHES];
+  unsigned overhead = run(b_empty, BENCH_ROUNDS) / BENCH_ROUNDS;
+
+  unsigned checked, bad = check_print_dec(&checked);
+  print("\nprint_dec cross-check: ");
+  print_dec(bad);
+  print(" mismatches in ");
+  print_dec(checked);
+  print(" values\n");
+
+  print("parser vocabulary check: ");
+  print_dec(parser_check());
+  print(" bad entries\n");
+
+  print("\n== dtekv-lib / timetemplate benchmarks ==\n");
+  for (unsigned i = 0; i < NUM_BENCHES; i++)
+    results[i] = per_call(run(benches[i].fn, benches[i].rounds), benches[i].rounds, overhead);
+
+  /* Report after everything has run, so the printing benches don't mix with the table. */
+  print("\n\nprimitive     cycles/call\n");
+  for (unsigned i = 0; i < NUM_BENCHES; i++) {
+    print((char*) benches[i].name);
+    print_dec(results[i]);
+    printc('\n');
+  }
+  print("(call overhead ");
+  print_dec(overhead);
+  print(" cycles subtracted)\n");
+
+  unsigned commands, errors;
+  unsigned parse_cycles = bench_parser(&commands, &errors);
+  unsigned bytes = (sizeof(parse_script) - 1) * BENCH_PARSE_ROUNDS;
+  print("\nparser: ");
+  print_dec(commands);
+  print(" commands + ");
+  print_dec(errors);
+  print(" errors from ");
+  print_dec(bytes);
+  print(" bytes, ");
+  print_dec(parse_cycles / (commands + errors));
+  print(" cycles/line, ");
+  print_dec(parse_cycles / bytes);
+  print(" cycles/byte\n");
+
+  timer_init(BENCH_IRQ_PERIOD_US, latency_isr);
+  while (irq_count != BENCH_IRQS);
+  irq_disable(TIMER_IRQ);
+  print("\ninterrupt entry to the timer handler: ");
+  print_dec(irq_min);
+  print(" min, ");
+  print_dec(irq_sum / BENCH_IRQS);
+  print(" avg, ");
+  print_dec(irq_max);
+  print(" max cycles over ");
+  print_dec(BENCH_IRQS);
+  print(" timer interrupts\n");
+  return 0;
+}
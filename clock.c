@@ -0,0 +1,60 @@
+/*clock.c - the lab 3 clock (labmain_old.c) without its while(1): the HH:MM:SS view (h) and
+clock_second, which the game's scheduler calls once a second so the clock keeps running next to
+the game. The displays are drawn through the framebuffer in seg7.c, so a new second usually only
+costs one MMIO store (HEX0).*/
+#include "clock.h"
+#include "seg7.h"
+#include "dtekv-lib.h"
+
+/*
+   (h) show HH:MM:SS on displays
+   - HEX5..HEX0 from left to right: [5][4] hours, [3][2] minutes, [1][0] seconds
+    */
+void show_time_on_displays(int hours, int minutes, int seconds) { // (h)
+  /* Rightmost pair (HEX0, HEX1) = seconds */
+  seg7_putc(1, '0' + (seconds / 10) % 10);  // HEX1 = tens of seconds (h)
+  seg7_putc(0, '0' +  seconds % 10);        // HEX0 = ones of seconds (h)
+
+
+  /* Middle pair (HEX2, HEX3) = minutes */
+  seg7_putc(3, '0' + (minutes / 10) % 10);  // HEX3 = tens of minutes (h)
+  seg7_putc(2, '0' +  minutes % 10);        // HEX2 = ones of minutes (h)
+
+
+  /* Left pair (HEX4, HEX5) = hours */
+  seg7_putc(5, '0' + (hours   / 10) % 10);  // HEX5 = tens of hours (h)
+  seg7_putc(4, '0' +  hours   % 10);        // HEX4 = ones of hours (h)
+
+  seg7_flush(); // only the digits that changed reach the displays
+}
+
+
+/*The time of the clock. The low 16 bits are MM:SS in BCD, the way tick (timetemplate.S) counts
+them. tick carries past 59:59 into bit 16, so the bits above are the hours.*/
+static int clock_time = 0;
+
+/* function: clock_show
+   Description: Draws the clock on the displays. MM:SS are BCD already, one
+   nibble per digit, so only the hours need a division. */
+void clock_show(void)
+{
+  unsigned hours = (unsigned) clock_time >> 16;
+
+  for (unsigned i = 0; i < 4; i++)
+    seg7_putc(i, '0' + ((clock_time >> (4 * i)) & 0xf));
+  seg7_putc(5, '0' + hours / 10);
+  seg7_putc(4, '0' + hours % 10);
+  seg7_flush();
+}
+
+/* function: clock_second
+   Description: Advances the clock by one second with tick and shows it,
+   unless a marquee has the displays. Wraps to 00:00:00 after 23:59:59. */
+void clock_second(void)
+{
+  tick(&clock_time);
+  if ((clock_time >> 16) >= 24)
+    clock_time &= 0xffff;
+  if (!seg7_marquee_busy())
+    clock_show();
+}
@@ -0,0 +1,9 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/* The HH:MM:SS clock of lab 3 on the six 7-segment displays */
+void show_time_on_displays(int hours, int minutes, int seconds);
+void clock_show(void);
+void clock_second(void);
+
+#endif
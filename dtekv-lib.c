@@ -1,54 +1,374 @@
 #include "dtekv-lib.h"
+#include "irq.h"
 
 #define JTAG_UART ((volatile unsigned int*) 0x04000040)
 #define JTAG_CTRL ((volatile unsigned int*) 0x04000044)
 
+#define JTAG_CTRL_WE 0x2   /* write-ready interrupt enable (bit 1 of the control register) */
+#define JTAG_WSPACE(ctrl) ((ctrl) >> 16)   /* free slots in the hardware FIFO */
+#define JTAG_RVALID 0x8000 /* data register: bits 7:0 hold a received character */
+
+/* Transmit ring buffer. Once uart_init has run, printc only copies the byte
+   into the ring and the JTAG UART write-ready interrupt moves it into the
+   hardware FIFO. head/tail are free running, head - tail is the fill level.
+   The size must be a power of two. */
+#define UART_TX_SIZE 1024
+
+static volatile char uart_tx_buf[UART_TX_SIZE];
+static volatile unsigned uart_tx_head;      /* written by printc only */
+static volatile unsigned uart_tx_tail;      /* written by uart_tx_pump only */
+static volatile unsigned uart_tx_overflows; /* times printc found the ring full */
+static int uart_irq_enabled = 0;
+
+/* Move as many bytes as the hardware FIFO has room for. The free space is
+   read once and then filled with back-to-back stores.
+   Must run with interrupts off (from the ISR or under irq_save). */
+static void uart_tx_pump(void)
+{
+  unsigned tail = uart_tx_tail;
+  unsigned n = uart_tx_head - tail;
+  unsigned space = JTAG_WSPACE(*JTAG_CTRL);
+  if (n > space) n = space;
+  while (n--) {
+    *JTAG_UART = uart_tx_buf[tail & (UART_TX_SIZE - 1)];
+    tail++;
+  }
+  uart_tx_tail = tail;
+}
+
+/* Ring full: count it and push bytes out ourselves until there is room. */
+static void uart_tx_wait_room(void)
+{
+  uart_tx_overflows++;
+  do {
+    unsigned st = irq_save();
+    uart_tx_pump();
+    irq_restore(st);
+  } while (uart_tx_head - uart_tx_tail == UART_TX_SIZE);
+}
+
+/* The JTAG UART write-ready interrupt */
+static void uart_tx_isr(unsigned cause)
+{
+  (void) cause;
+  uart_tx_pump();
+  if (uart_tx_tail == uart_tx_head)
+    *JTAG_CTRL = 0;   /* nothing left, stop the write-ready interrupt */
+}
+
+void uart_init(void)
+{
+  uart_irq_enabled = 1;
+  irq_register(JTAG_UART_IRQ, uart_tx_isr);
+}
+
+/* Block until everything queued has been handed to the hardware FIFO.
+   Drains directly, so it also works from trap context where the ISR can't run. */
+void uart_flush(void)
+{
+  while (uart_tx_tail != uart_tx_head) {
+    unsigned s = irq_save();
+    uart_tx_pump();
+    irq_restore(s);
+  }
+}
+
+/* function: soft_reset
+   Description: Starts the program over without reloading it: the queued text
+   goes out, interrupts go off and we jump to the "j _start" slot at address 4
+   of boot.S. _start clears .bss again, .noinit (the saved game, save.c)
+   keeps its contents. */
+void soft_reset(void)
+{
+  uart_flush();
+  irq_save();
+  ((void (*)(void)) 4)();
+}
+
+unsigned uart_tx_overflow_count(void)
+{
+  return uart_tx_overflows;
+}
+
+/* Received character, or -1 when the receive FIFO is empty. Never waits.
+   Reading the data register takes the character out of the FIFO. */
+int uart_getc(void)
+{
+  unsigned d = *JTAG_UART;
+  return (d & JTAG_RVALID) ? (int) (d & 0xff) : -1;
+}
+
 void printc(char s)
 {
+  if (!uart_irq_enabled) {   /* boot message and anything before uart_init */
     while (((*JTAG_CTRL)&0xffff0000) == 0);
     *JTAG_UART = s;
+    return;
+  }
+
+  if (uart_tx_head - uart_tx_tail == UART_TX_SIZE)
+    uart_tx_wait_room();
+  unsigned head = uart_tx_head;
+  uart_tx_buf[head & (UART_TX_SIZE - 1)] = s;
+  uart_tx_head = head + 1;
+  *JTAG_CTRL = JTAG_CTRL_WE;
+}
+
+/* Bulk writer: one status read per burst instead of one per character.
+   Without the ring it fills every free FIFO slot per read of JTAG_CTRL,
+   with the ring it copies as much as fits in one go. */
+void print_n(const char *s, unsigned len)
+{
+  if (!uart_irq_enabled) {
+    while (len != 0) {
+      unsigned n = JTAG_WSPACE(*JTAG_CTRL);
+      if (n > len) n = len;
+      len -= n;
+      while (n--)
+        *JTAG_UART = *s++;
+    }
+    return;
+  }
+
+  while (len != 0) {
+    unsigned head = uart_tx_head;
+    unsigned n = UART_TX_SIZE - (head - uart_tx_tail);
+    if (n == 0) {
+      uart_tx_wait_room();
+      continue;
+    }
+    if (n > len) n = len;
+    len -= n;
+    while (n--) {
+      uart_tx_buf[head & (UART_TX_SIZE - 1)] = *s++;
+      head++;
+    }
+    uart_tx_head = head;
+    *JTAG_CTRL = JTAG_CTRL_WE;
+  }
 }
 
+/* Same as print_n but stops at the terminating zero, still in a single pass. */
 void print(char *s)
 {  
-  while (*s != '\0') {    
-      printc(*s);
-      s++;
+  while (*s != '\0') {
+    unsigned n;
+    if (!uart_irq_enabled) {
+      n = JTAG_WSPACE(*JTAG_CTRL);
+      while (n != 0 && *s != '\0') {
+        *JTAG_UART = *s++;
+        n--;
+      }
+      continue;
+    }
+
+    unsigned head = uart_tx_head;
+    n = UART_TX_SIZE - (head - uart_tx_tail);
+    if (n == 0) {
+      uart_tx_wait_room();
+      continue;
+    }
+    while (n != 0 && *s != '\0') {
+      uart_tx_buf[head & (UART_TX_SIZE - 1)] = *s++;
+      head++;
+      n--;
+    }
+    uart_tx_head = head;
+    *JTAG_CTRL = JTAG_CTRL_WE;
   }
 }
 
+/* "00" "01" ... "99": two decimal digits per lookup */
+static const char digit_pairs[200] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/* x / 100 without divu: multiply by 2^37/100 (rounded up) and keep the
+   top bits. Exact for every 32-bit x; compiles to mulhu + srli. */
+static inline unsigned div100(unsigned x)
+{
+  return (unsigned) (((unsigned long long) x * 0x51EB851Fu) >> 37);
+}
+
+/* Writes the digits of x backwards so they end just before end,
+   returns a pointer to the first digit. */
+static char *dec_digits(char *end, unsigned x)
+{
+  char *p = end;
+  while (x >= 100) {
+    unsigned q = div100(x);
+    unsigned r = 2 * (x - q * 100);
+    p -= 2;
+    p[0] = digit_pairs[r];
+    p[1] = digit_pairs[r + 1];
+    x = q;
+  }
+  if (x >= 10) {
+    p -= 2;
+    p[0] = digit_pairs[2 * x];
+    p[1] = digit_pairs[2 * x + 1];
+  } else {
+    *--p = '0' + x;
+  }
+  return p;
+}
+
+/* function: format_dec
+   Description: Writes x in decimal to buf (at least 10 chars, no terminating
+   zero) and returns the number of characters. */
+unsigned format_dec(char *buf, unsigned x)
+{
+  char tmp[10];
+  char *p = dec_digits(tmp + 10, x);
+  unsigned n = tmp + 10 - p;
+  for (unsigned i = 0; i < n; i++)
+    buf[i] = p[i];
+  return n;
+}
+
 void print_dec(unsigned int x)
 {
-  unsigned divident = 1000000000;
-  char first = 0;
-  do {
-    int dv = x / divident;
-    if (dv != 0) first = 1;
-    if (first != 0)
-      printc(48+dv);
-    x -= dv*divident;
-    divident /= 10;
-  } while (divident != 0);
-    if (first == 0)
-	printc(48);
+  char buf[10];
+  char *p = dec_digits(buf + 10, x);
+  print_n(p, buf + 10 - p);
+}
+
+void print_dec_signed(int x)
+{
+  char buf[11];
+  char *p = dec_digits(buf + 11, x < 0 ? 0u - (unsigned) x : (unsigned) x);
+  if (x < 0)
+    *--p = '-';
+  print_n(p, buf + 11 - p);
+}
+
+/* function: print_dec_pad
+   Description: Prints x right-aligned in at least width characters, filled
+   with pad on the left. pad = '0' gives zero-padded fields ("07" for
+   HH:MM:SS), pad = ' ' gives fixed-width columns. */
+void print_dec_pad(unsigned int x, unsigned width, char pad)
+{
+  char buf[16];
+  if (width > sizeof(buf)) width = sizeof(buf);
+  char *p = dec_digits(buf + sizeof(buf), x);
+  while ((unsigned) (buf + sizeof(buf) - p) < width)
+    *--p = pad;
+  print_n(p, buf + sizeof(buf) - p);
+}
+
+/* function: hexasc4
+   Description: Branch-free hex-to-ASCII for four nibbles at once (SIMD within
+   a register). Returns the ASCII digits of v[15:0] packed in a word with the
+   most significant digit in the lowest byte, so one little-endian word store
+   writes them in reading order. Each byte first gets one nibble n; n + 6
+   carries into bit 4 exactly when n >= 10, and that bit selects the extra 7
+   that turns '0'+10 into 'A'. No byte ever carries into the next one. */
+unsigned hexasc4(unsigned v)
+{
+  unsigned x = ((v >> 8) & 0xff) | ((v & 0xff) << 16);       /* hi byte -> byte 0, lo byte -> byte 2 */
+  x = ((x >> 4) & 0x000f000f) | ((x & 0x000f000f) << 8);     /* one nibble per byte */
+  return x + 0x30303030 + (((x + 0x06060606) >> 4) & 0x01010101) * 7;
 }
 
 void print_hex32 ( unsigned int x)
 {
-  printc('0');
-  printc('x');
-  for (int i = 7; i >= 0; i--) {
-    char hd = (char) ((x >> (i*4)) & 0xf);
-    if (hd < 10)
-      hd += '0';
-    else
-      hd += ('A' - 10);
-    printc(hd);
-  }   
+  /* "0x" in the top half of word 0, the eight digits in words 1 and 2 */
+  unsigned buf[3];
+  buf[0] = ('0' << 16) | ('x' << 24);
+  buf[1] = hexasc4(x >> 16);
+  buf[2] = hexasc4(x & 0xffff);
+  print_n((char*) buf + 2, 10);
+}
+
+/* Syscall layer for the print syscalls (a7 = 4 print string, a7 = 11 print char).
+   Everything on the DTEK-V runs in machine mode, so instead of trapping through
+   ecall -> _isr_routine -> handle_exception we call the UART code directly.
+   Build with -DSYSCALL_TRAP to get the old ecall behaviour back (e.g. for RARS). */
+void sys_print(const char *s)
+{
+#ifdef SYSCALL_TRAP
+  register const char *a0 asm("a0") = s;
+  register unsigned a7 asm("a7") = 4;
+  asm volatile ("ecall" :: "r"(a0), "r"(a7) : "memory");
+#else
+  print((char*) s);
+#endif
+}
+
+void sys_printc(char c)
+{
+#ifdef SYSCALL_TRAP
+  register unsigned a0 asm("a0") = (unsigned char) c;
+  register unsigned a7 asm("a7") = 11;
+  asm volatile ("ecall" :: "r"(a0), "r"(a7) : "memory");
+#else
+  printc(c);
+#endif
+}
+
+static void __attribute__((noinline)) sys_nop(void)
+{
+  asm volatile ("");
+}
+
+/* function: syscall_report
+   Description: Measures what an ecall costs compared with calling the same
+   code directly and prints the average cycles per call. The null syscall
+   (a7 = 0) is handled by handle_exception without doing anything, so it is
+   the pure trap round trip: register save/restore, mcause decode and mepc fixup. */
+#define SYSCALL_ROUNDS 64
+void syscall_report(void)
+{
+  unsigned t0, trap_null, direct_null, trap_char, direct_char;
+  int i;
+
+  t0 = read_mcycle();
+  for (i = 0; i < SYSCALL_ROUNDS; i++) {
+    register unsigned a7 asm("a7") = 0;
+    asm volatile ("ecall" :: "r"(a7) : "memory");
+  }
+  trap_null = read_mcycle() - t0;
+
+  t0 = read_mcycle();
+  for (i = 0; i < SYSCALL_ROUNDS; i++)
+    sys_nop();
+  direct_null = read_mcycle() - t0;
+
+  uart_flush();
+  t0 = read_mcycle();
+  for (i = 0; i < SYSCALL_ROUNDS; i++) {
+    register unsigned a0 asm("a0") = '.';
+    register unsigned a7 asm("a7") = 11;
+    asm volatile ("ecall" :: "r"(a0), "r"(a7) : "memory");
+  }
+  uart_flush();
+  trap_char = read_mcycle() - t0;
+
+  t0 = read_mcycle();
+  for (i = 0; i < SYSCALL_ROUNDS; i++)
+    printc('.');
+  uart_flush();
+  direct_char = read_mcycle() - t0;
+
+  print("\nCycles per call (ecall / direct):\n  null syscall: ");
+  print_dec(trap_null / SYSCALL_ROUNDS); print(" / ");
+  print_dec(direct_null / SYSCALL_ROUNDS);
+  print("\n  print char:   ");
+  print_dec(trap_char / SYSCALL_ROUNDS); print(" / ");
+  print_dec(direct_char / SYSCALL_ROUNDS);
+  printc('\n');
 }
 
+/* The register frame of the last exception, set by boot.S before it calls
+   handle_exception: xN is trap_frame[N - 1] (x2, sp, is trap_frame + 32). */
+unsigned *trap_frame;
+
 /* function: handle_exception
-   Description: This code handles an exception. */
+   Description: This code handles an exception. Fatal ones end in a dump of
+   the address and all registers, then the CPU stops here. */
 void handle_exception ( unsigned arg0, unsigned arg1, unsigned arg2, unsigned arg3, unsigned arg4, unsigned arg5, unsigned mcause, unsigned syscall_num )
 {
   switch (mcause)
@@ -71,8 +391,18 @@ void handle_exception ( unsigned arg0, unsigned arg1, unsigned arg2, unsigned ar
       break;
     }
   
+  uart_flush();
+  uart_irq_enabled = 0;   /* we never return, print the dump synchronously */
   print("Exception Address: ");
   print_hex32(arg0); printc('\n');
+  for (int n = 0; n < 32; n++) {
+    unsigned x = n == 0 ? 0 : n == 2 ? (unsigned) (trap_frame + 32) : trap_frame[n - 1];
+    print(n < 10 ? " x" : "x");
+    print_dec(n);
+    print(": ");
+    print_hex32(x);
+    printc(n % 4 == 3 ? '\n' : ' ');
+  }
   while (1);
 }
 
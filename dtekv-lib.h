@@ -1,10 +1,78 @@
+#ifndef DTEKV_LIB_H
+#define DTEKV_LIB_H
+
 void printc(char );
 void print(char *);
+void print_n(const char *, unsigned len);
 void print_dec(unsigned int);
+void print_dec_signed(int);
+void print_dec_pad(unsigned int, unsigned width, char pad);
+unsigned format_dec(char *buf, unsigned int);
 void print_hex32 ( unsigned int);
 void handle_exception ( unsigned arg0, unsigned arg1, unsigned arg2, unsigned arg3, unsigned arg4, unsigned arg5, unsigned mcause, unsigned syscall_num );
+extern unsigned *trap_frame;   /* registers saved by boot.S for the last exception */
 int nextprime( int inval );
+unsigned hexasc4(unsigned);
+
+/* timetemplate.S */
+void tick(int *);
+void time2string(char *, int);
+char hexasc(int);
+void delay(int);
+
+/* Print syscalls without the ecall trap (see dtekv-lib.c) */
+void sys_print(const char *);
+void sys_printc(char);
+void syscall_report(void);
+
+/* Length-prefixed strings, printed with print_n without a strlen pass */
+struct lstr {
+  unsigned len;
+  const char *s;
+};
+#define LSTR(lit) { sizeof(lit) - 1, lit }
+#define print_lit(lit) print_n(lit, sizeof(lit) - 1)
+
+#ifdef HAL_HOST
+/* Host build (host/host-lib.c): no cycle counter, "cycles" are nanoseconds */
+#define MCYCLE_HZ 1000000000u
+#define MCYCLE_UNIT "ns"
+unsigned read_mcycle(void);
+static inline unsigned irq_save(void) { return 0; }
+static inline void irq_restore(unsigned status) { (void) status; }
+#else
+#define MCYCLE_HZ 30000000u   /* the DTEK-V core runs at 30 MHz */
+#define MCYCLE_UNIT "cycles"
+
+static inline unsigned read_mcycle(void)
+{
+  unsigned c;
+  asm volatile ("csrr %0, mcycle" : "=r"(c));
+  return c;
+}
+
+/* Turn interrupts off (mstatus.MIE) and back to what they were */
+static inline unsigned irq_save(void)
+{
+  unsigned status;
+  asm volatile ("csrrci %0, mstatus, 8" : "=r"(status) :: "memory");
+  return status & 8;
+}
 
+static inline void irq_restore(unsigned status)
+{
+  if (status)
+    asm volatile ("csrsi mstatus, 8" ::: "memory");
+}
+#endif
 
+/* Interrupt-driven JTAG UART output */
+#define JTAG_UART_IRQ 19   /* mcause of the JTAG UART interrupt on the DTEK-V */
+void uart_init(void);
+void uart_flush(void);
+unsigned uart_tx_overflow_count(void);
+int uart_getc(void);
 
+void soft_reset(void);
 
+#endif
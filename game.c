@@ -0,0 +1,928 @@
+/*game.c - the Mystery House game itself: the world, the game state, the item rules and the
+command table. There is no hardware in here: the LEDs go through hal.h and all text through the
+dtekv-lib.h print functions, so the same code runs on the board (labmain.c) and as a native
+program on a PC (host/game-host.c).*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "dtekv-lib.h"
+#include "hal.h"
+#include "idle.h"
+#include "sched.h"
+#include "save.h"
+#include "profile.h"
+#include "parser.h"
+#include "route.h"
+#include "game.h"
+
+/*DEFINING THE ROOMS AND CORE GAME STATE*/
+#define NUM_ROOMS 9 //the compiler knows how big the world is.
+
+struct room { //everywhere in the code we will use struct room instead of room.
+  struct lstr name; //length + pointer to a string literal like "Kitchen", so print_n needs no strlen
+  struct lstr desc; //description text
+  char *lock_msg; //message printed if the room is locked when the player tries to enter.
+};
+
+/*The exits are not in the struct: the map is stored as structure-of-arrays, like the generated
+worlds in world.c. room_exits[id][direction] is the room you get to when walking that way from
+room id, -1 = no exit. Directions are 0 north, 1 south, 2 east, 3 west (the switch argument).
+If you're in the entrance hall (room 0) and going north should take you to the Living Room (room 1),
+then room_exits[0][DIR_NORTH] = 1. Four int16_t per room = 8 bytes, one load per move.*/
+#define DIR_NORTH 0
+#define DIR_SOUTH 1
+#define DIR_EAST  2
+#define DIR_WEST  3
+
+//Dark, locked and items are not in the struct any more either: they are single bits in the game state below.
+
+/*The world layout:
+- 0 Entrance Hall
+- 1 Living Room (flashlight here)
+- 2 Kitchen
+- 3 Basement (dark)
+- 4 Upstairs Hall
+- 5 Bedroom
+- 6 Study (silver key here)
+- 7 Storage Room (locked, brass key here, opens with silver key)
+- 8 Exit Door (locked, win room) */
+
+static const struct room rooms[NUM_ROOMS] = { //const: names, texts etc. live in .rodata, nothing is copied at boot
+  { LSTR("Entrance Hall"), LSTR("The front door slams shut behind you. The house is silent."), 0 },
+  { LSTR("Living Room"),   LSTR("A cracked fireplace. Something glints under the sofa."), 0 },
+  { LSTR("Kitchen"),       LSTR("Dusty plates. A narrow stairwell leads down."), 0 },
+  { LSTR("Basement"),      LSTR("Cold concrete. You hear water dripping in the dark."), 0 },
+  { LSTR("Upstairs Hall"), LSTR("Portraits stare at you. A door to the east is slightly open."), 0 },
+  { LSTR("Bedroom"),       LSTR("An unmade bed. The window is nailed shut."), 0 },
+  { LSTR("Study"),         LSTR("A desk covered in notes. One drawer is ajar."), 0 },
+  { LSTR("Storage Room"),  LSTR("Old crates. A heavy brass key hangs on a hook."),
+    "The Storage Room is locked. You need a silver key." },
+  { LSTR("Exit Door"),     LSTR("A reinforced door with a brass lock. Fresh air seeps through."),
+    "The Exit Door is locked. A brass key might fit." },
+};
+
+static const int16_t room_exits[NUM_ROOMS][4] = {
+  //  north south east west
+  {   1,   -1,   -1,   8 },  // 0 Entrance Hall: north -> Living Room, west -> Exit Door
+  {   4,    0,    2,  -1 },  // 1 Living Room: north -> Upstairs Hall, south -> Entrance Hall, east -> Kitchen
+  {  -1,    3,    7,   1 },  // 2 Kitchen: south -> Basement, east -> Storage Room, west -> Living Room
+  {   2,   -1,   -1,  -1 },  // 3 Basement: north -> Kitchen
+  {   6,    1,    5,  -1 },  // 4 Upstairs Hall: north -> Study, south -> Living Room, east -> Bedroom
+  {  -1,   -1,   -1,   4 },  // 5 Bedroom: west -> Upstairs Hall
+  {  -1,    4,   -1,  -1 },  // 6 Study: south -> Upstairs Hall
+  {  -1,   -1,   -1,   2 },  // 7 Storage Room: west -> Kitchen
+  {  -1,   -1,    0,  -1 },  // 8 Exit Door: east -> Entrance Hall
+};
+
+/*ITEMS
+Items are data, not code: every item is one entry in the items[] table below and the
+engine only ever looks at item ids and bits. Adding an item (or a door that needs two keys)
+means adding table entries, not new branches.
+- kind: what "use" does with it. ITEM_LIGHT toggles the light, ITEM_KEY works on a door.
+- led: which LED lights up while the player carries it (-1 = none)
+- unlocks: for keys, the room whose door it opens. A door opens when ALL keys that name
+  it have been used, so two keys with the same unlocks make a two-key door.
+- taken, not_carried, used: the item's own messages, so each item keeps its wording
+Inventory and item sets are item_mask_t bitmasks (bit n = item n). 32 items fit in the
+default 32-bit mask, make it uint64_t for up to 64.*/
+
+typedef uint32_t item_mask_t;
+
+enum item_kind {
+  ITEM_LIGHT,
+  ITEM_KEY,
+  NUM_ITEM_KINDS
+};
+
+struct item {
+  struct lstr name;
+  unsigned char kind;
+  signed char led;
+  signed char unlocks;
+  const char *taken;       //printed when the player picks it up
+  const char *not_carried; //printed when the player uses it without having it
+  const char *used;        //light: printed before "ON."/"OFF.", key: printed when its door opens
+};
+
+//item map: 0 -> flashlight, 1 -> silver key, 2 -> brass key (the switch argument is the item id)
+static const struct item items[] = {
+  { LSTR("flashlight"), ITEM_LIGHT, 0, -1,
+    "You picked up the flashlight. \n", "You don't have a flashlight. \n", "Flashlight " },
+  { LSTR("silver key"), ITEM_KEY,   1,  7,    //opens the Storage Room
+    "You took the silver key. \n", "You don't have the silver key.\n", "You unlock the Storage Room.\n" },
+  { LSTR("brass key"),  ITEM_KEY,   2,  8,    //opens the Exit Door
+    "You took the brass key. \n", "You don't have the brass key. \n", "You unlocked the Exit Door. \n" },
+};
+
+#define NUM_ITEMS ((int) (sizeof(items) / sizeof(items[0])))
+#define ITEM_BIT(item) ((item_mask_t) 1 << (item))
+_Static_assert(NUM_ITEMS <= CMD_ITEM_MAX + 1, "item ids must fit the item field of take/use (SW9..SW5)");
+_Static_assert(NUM_ITEMS <= 8 * (int) sizeof(item_mask_t), "items must fit item_mask_t");
+
+//Which items lie in each room when the game starts
+static const item_mask_t room_items[NUM_ROOMS] = {
+  [1] = ITEM_BIT(0),   //flashlight in the Living Room
+  [6] = ITEM_BIT(1),   //silver key in the Study
+  [7] = ITEM_BIT(2),   //brass key in the Storage Room
+};
+
+/*GAME STATE AS BITS
+Everything that changes while playing is packed into five words, so a whole game fits in 20 bytes
+(one cache line): copying it is a snapshot, comparing it is five compares.
+- room: where the player is
+- inventory: bit n = the player carries item n. Items can't be dropped, so an item is still in
+  its room exactly when its bit is in room_items[room] and not in the inventory.
+- keys_used: keys that have been turned in their door (for doors that need more than one)
+- flags: GAME_LIGHT_ON when a light is switched on
+- locked: bit n = room n is locked*/
+
+#define ROOM_BIT(id) (1u << (id))
+
+#define GAME_LIGHT_ON 0x1
+
+#define DARK_ROOMS ROOM_BIT(3)   //Basement, never changes
+
+struct game_state {
+  unsigned room;
+  item_mask_t inventory;
+  item_mask_t keys_used;
+  unsigned flags;
+  unsigned locked;
+};
+
+//How every game starts (const, in .rodata)
+static const struct game_state new_game = {
+  .room = 0,                                  //Entrance Hall
+  .locked = ROOM_BIT(7) | ROOM_BIT(8),        //Storage Room and Exit Door
+};
+
+static struct game_state game; //the running game (.bss)
+static unsigned led_mask;      //LEDs of the carried items, kept up to date by handle_take
+static unsigned moves;         //commands given so far, for the HEX display marquee (not part of the rules)
+
+/*ROUTING
+route.c knows the shortest way between any two rooms (for the travel command). It reads
+room_exits and gets a bitmask of the rooms can_enter would refuse right now:
+locked rooms, and the dark rooms while the light is off. When that mask changes (handle_use
+unlocking a door or switching the light) route_sync tells route.c which rooms changed and only
+the routes that depend on them are redone, the next time someone travels there.*/
+static uint32_t route_blocked; //what route.c currently treats as blocked
+
+static uint32_t blocked_rooms(void) {
+  return game.locked | ((game.flags & GAME_LIGHT_ON) ? 0 : DARK_ROOMS);
+}
+
+_Static_assert(NUM_ROOMS <= ROUTE_MAX_ROOMS, "route.c must be built for at least NUM_ROOMS rooms");
+
+static void route_setup(void) {
+  route_blocked = blocked_rooms();
+  if (!route_init(NUM_ROOMS, room_exits, &route_blocked)) //BFS for every room, once at boot
+    print("Travel is off: route.c can't route this map.\n");
+}
+
+static void route_sync(void) {
+  uint32_t now = blocked_rooms();
+  uint32_t changed = now ^ route_blocked;
+  for (int i = 0; changed != 0; i++, changed >>= 1) {
+    if (changed & 1) route_set_blocked(i, (now >> i) & 1);
+  }
+  route_blocked = now;
+}
+
+//Start a new game: one 20 byte copy, the world itself is const.
+static void init_world(void) {
+  game = new_game;
+  led_mask = 0;
+  moves = 0;
+  route_setup();
+}
+
+static item_mask_t items_here(const struct game_state *g, int id) {
+  return room_items[id] & ~g->inventory;
+}
+
+//show things to the player (LEDs + room text)
+/*The LEDs show the items the player has in their inventory (LED0 flashlight, LED1 silver key,
+LED2 brass key, see the led column of items[]). led_mask is updated when an item is taken,
+so this is one load and one store.
+*/
+static void update_status_leds(void) {
+  hal_set_leds(led_mask); //writes the mask into the LED register (or the host's LED word)
+}
+
+//print_room is a function that, given a room index (id), prints: 
+/*
+- room name
+- room description
+- any items in the room
+- the exists (north, south, east, west) that exist 
+*/
+
+static void print_room (int id) {
+  PROF_BEGIN(PROF_PRINT_ROOM);
+  const struct room *r = &rooms[id]; //address of room[some number]
+  item_mask_t here = items_here(&game, id);
+
+  print_lit("\n== ");
+  print_n(r->name.s, r->name.len);
+  print_lit(" #"); //room number, for travel
+  print_dec(id);
+  print_lit( " ==\n");
+  print_n(r->desc.s, r->desc.len);
+  print_lit("\n");
+
+  /* Output will be: == Entrance Hall ==
+                      The front door slammed shut behind you..
+  */
+
+//Printing items in the room:
+if (here) { //first we check if any item bit of this room is still set
+  print("Items here:"); //if yes: print items here plus the names of the items present.
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (here & ITEM_BIT(i)) {
+      print_lit(" ");
+      print_n(items[i].name.s, items[i].name.len);
+    }
+  }
+  print("\n"); 
+}
+
+//Printing exists:
+print("Exists:");
+const int16_t *exits = room_exits[id];
+if (exits[DIR_NORTH] != -1) print(" north");
+if (exits[DIR_SOUTH] != -1) print (" south");
+if (exits[DIR_EAST] != -1) print (" east");
+if (exits[DIR_WEST] != -1) print (" west");
+print ("\n"); 
+//when any of them is -1, there is not exist, don't print it.
+PROF_END(PROF_PRINT_ROOM);
+
+}
+
+//Change current room and show the room.
+static void enter_room(int id) {
+  game.room = id; 
+  print_room(id); 
+}
+
+/*GAME LOGIC, moving between rooms, picking items, using items etc.
+The rules take the state as an argument (the game uses &game) and never print, so
+host/explore.c can run them on any state it likes; the handle_ functions do the talking.*/
+enum enter_result {
+  ENTER_OK,
+  ENTER_LOCKED,
+  ENTER_DARK
+};
+
+static int enter_check(const struct game_state *g, int to_id) {
+  if (g->locked & ROOM_BIT(to_id)) {
+    return ENTER_LOCKED;
+  }
+  if ((DARK_ROOMS & ROOM_BIT(to_id)) && !(g->flags & GAME_LIGHT_ON)) { //light can only be on if we carry a light
+    return ENTER_DARK;
+  }
+  return ENTER_OK; //safe to enter
+}
+
+static int can_enter(int to_id) {
+  switch (enter_check(&game, to_id)) {
+  case ENTER_LOCKED:
+    print (rooms[to_id].lock_msg);
+    print ("\n");
+    return 0;
+  case ENTER_DARK:
+    print("It's too dark to go there without flashligh. \n");
+    return 0; 
+  }
+  return 1;
+}
+
+//direction map: 0 -> north, 1 -> south, 2 -> east, 3 -> west
+
+static void handle_go (int direction) {
+  int to = room_exits[game.room][direction & 3];
+
+  if (to == -1) {
+    print ("You can't go that way. \n");
+    return; 
+  }
+
+  if (can_enter(to)) {
+    enter_room(to);
+  }
+}
+
+/*The item rules, without any printing: they only change the state they get and say what happened,
+and the handle_ functions turn that into text. Every item goes through the same code.*/
+enum use_result {
+  USE_NOT_CARRIED,   //player doesn't have it
+  USE_LIGHT_ON,
+  USE_LIGHT_OFF,
+  USE_NO_DOOR,       //key, but its door is not next to this room
+  USE_KEY_TURNED,    //key used, the door still needs another key
+  USE_UNLOCKED       //key used and the door is open now
+};
+
+//Bit test-and-clear: is the item in this room? then it moves to the inventory.
+static int take_item(struct game_state *g, int item) {
+  item_mask_t bit = ITEM_BIT(item);
+  if (!(items_here(g, g->room) & bit)) {
+    return 0;
+  }
+  g->inventory |= bit;
+  return 1;
+}
+
+static int use_light(struct game_state *g, int item) {
+  (void) item;
+  g->flags ^= GAME_LIGHT_ON;
+  return (g->flags & GAME_LIGHT_ON) ? USE_LIGHT_ON : USE_LIGHT_OFF;
+}
+
+static int use_key(struct game_state *g, int item) {
+  const int16_t *exits = room_exits[g->room];
+  int door = items[item].unlocks;
+
+  if (exits[0] != door && exits[1] != door && exits[2] != door && exits[3] != door) {
+    return USE_NO_DOOR;
+  }
+  g->keys_used |= ITEM_BIT(item);
+
+  //every key that belongs to this door must have been used
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (items[i].kind == ITEM_KEY && items[i].unlocks == door && !(g->keys_used & ITEM_BIT(i))) {
+      return USE_KEY_TURNED;
+    }
+  }
+  g->locked &= ~ROOM_BIT(door);
+  return USE_UNLOCKED;
+}
+
+//"use" dispatch: one indexed call on the item kind
+static int (*const use_by_kind[NUM_ITEM_KINDS])(struct game_state *g, int item) = {
+  [ITEM_LIGHT] = use_light,
+  [ITEM_KEY]   = use_key,
+};
+
+static int use_item(struct game_state *g, int item) {
+  if (!(g->inventory & ITEM_BIT(item))) {
+    return USE_NOT_CARRIED;
+  }
+  return use_by_kind[items[item].kind](g, item);
+}
+
+//win condition: standing in the Exit Door room with it unlocked
+static int game_won(const struct game_state *g) {
+  return g->room == 8 && !(g->locked & ROOM_BIT(8));
+}
+
+static void print_item(const char *before, int item, const char *after) {
+  print((char*) before);
+  print_n(items[item].name.s, items[item].name.len);
+  print((char*) after);
+}
+
+static void handle_take (int item) {
+  if (take_item(&game, item)) { //Was the item actually in the room?
+    if (items[item].led >= 0) led_mask |= 1u << items[item].led;
+    update_status_leds();
+    print((char*) items[item].taken);
+  } else {
+    print_item("No ", item, " here. \n");
+  }
+}
+
+static void handle_use(int item) {
+  switch (use_item(&game, item)) {
+  case USE_NOT_CARRIED:
+    print((char*) items[item].not_carried);
+    break;
+  case USE_LIGHT_ON:
+  case USE_LIGHT_OFF:
+    print((char*) items[item].used);
+    print((game.flags & GAME_LIGHT_ON) ? "ON.\n" : "OFF.\n");
+    break;
+  case USE_NO_DOOR:
+    print_item("Nothing here fits the ", item, ". \n");
+    break;
+  case USE_KEY_TURNED:
+    print_item("The ", item, " turns, but the lock needs another key.\n");
+    break;
+  case USE_UNLOCKED:
+    print((char*) items[item].used);
+    break;
+  }
+  route_sync(); //a door or the light may have changed what can be entered
+}
+
+static void print_inventory (void) {
+  print ("You are carrying: \n");
+
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (!(game.inventory & ITEM_BIT(i))) continue;
+    print_n(items[i].name.s, items[i].name.len);
+    if (items[i].kind == ITEM_LIGHT) {
+      print((game.flags & GAME_LIGHT_ON) ? " (ON)" : " (OFF)");
+    }
+    print("\n");
+  }
+  if (game.inventory == 0)
+  print("nothing\n");
+
+}
+
+//win condition
+int check_end(void) {
+  if (game_won(&game)) {
+    print("\nYou unlock the door and escape the Mystery House HAHAHA!\n");
+    print("We hope to see you again...\n");
+    return 1; //game ends
+  }
+  return 0; 
+}
+
+/*What is happening in handle_use?
+The player uses switches to chose what ACTION to perform (go, take, use, inventory)
+Which ITEM or direction (flashlight, keys, north, etc.) then presses the button to confirm. So 
+handle_use is called because the player used the switches and pressed the button. It performs the 
+"use item" action chosen by the player. What happens depends on the item's kind in items[]: a light
+toggles ON/OFF, a key tries to unlock the room in its unlocks column (silver key -> room 7 storage,
+brass key -> room 8 exit door).
+handle_use does not read the switches, it only reacts to an argument (the item id) that comes from the switch decoder.*/
+
+/*SWITCH DECODER- what switches trigger different actions
+button = "do it now", switches = "what to do". We want a function that reads
+the switches, decides what the player meant, calls the right game function (handle_go, handle_take, handle_use,
+print_inventory, etc.)
+
+Command Encoding (what the switches mean)
+We will use the 4 lowest switches: SW3...SW0.
+- SW3..SW2 (2 bits) = command type
+- SW1..SW0 (2 bits) = argument (take and use: off, their item is on SW9..SW5)
+
+So: 
+Command type (SW3..SW2)
+Bits:
+- 00 meaning: GO
+- 01 meaning: TAKE
+- 10 meaning: USE
+- 11 meaning: OTHER (inventory, look)
+
+Argument (SW1..SW0)
+- For go: 
+00 direction: north
+01 direction: south
+10 direction: east
+11 direction: west
+
+-For take and use: 00, the item id is on SW9..SW5 (up to 32 items, see items[])
+00000 item: flashlight
+00001 item: silver key
+00010 item: brass key
+
+-For "other"
+00 action: look
+01 action: inventory
+10 action: load (busy/idle cycles of the last second, and the scheduler's tasks)
+11 action: profile dump (only in PROFILE=1 builds)
+
+SW4 on (with SW3..SW0 off) is TRAVEL: walk the shortest way to the room whose number is on
+SW9..SW5 and only show the room you end up in. SW4 + SW0 shows the saved game as hex (typed:
+"save"), SW4 + SW1 is a soft reset that comes back from the last save ("reset"). With SW4 on, all
+other SW3..SW0 combos are invalid.
+
+*/
+
+/*COMMAND TABLE
+Instead of walking a chain of ifs, the switch value is used directly as an index into a const
+table of handler pointers: one masked load and one indirect jump per press, no matter how
+many commands there are. The table below is the command registry: a command is registered by
+giving its switch code(s) a handler, every code nobody registered falls back to cmd_invalid.
+Each handler gets the whole switch value and picks its own argument out of it.
+
+COMMAND_BITS is how many switches select the command. 5 = SW4..SW0 as described above (32 entries),
+the switches above that are arguments (travel's room number). It can go up to 10 (all switches
+from get_sw, 1024 entries) for bigger command sets: the table grows, the dispatch stays one load
+and one jump.*/
+#define COMMAND_BITS 5
+#define NUM_COMMANDS (1 << COMMAND_BITS)
+//CMD(type, arg) and CMD_GO..CMD_OTHER are in parser.h: typed commands use the same codes
+
+typedef void (*command_fn)(int sw);
+
+static void cmd_go(int sw) {
+  PROF_BEGIN(PROF_GO);
+  handle_go(sw & 0x3);          // 0: north, 1: south, 2: east, 3: west
+  PROF_END(PROF_GO);
+}
+
+static void cmd_take(int sw) {
+  int item = (unsigned) sw >> CMD_ITEM_SHIFT;   // item id, see items[]: 0 flashlight, 1 silver key, 2 brass key
+  if (item >= NUM_ITEMS) {
+    print("Nothing to take with that switch combo.\n");
+    return;
+  }
+  PROF_BEGIN(PROF_TAKE);
+  handle_take(item);
+  PROF_END(PROF_TAKE);
+}
+
+static void cmd_use(int sw) {
+  int item = (unsigned) sw >> CMD_ITEM_SHIFT;
+  if (item >= NUM_ITEMS) {
+    print("No such item to use.\n");
+    return;
+  }
+  PROF_BEGIN(PROF_USE);
+  handle_use(item);
+  PROF_END(PROF_USE);
+}
+
+static void cmd_look(int sw) {
+  (void) sw;
+  print_room(game.room);
+}
+
+static void cmd_inventory(int sw) {
+  (void) sw;
+  print_inventory();
+}
+
+static void cmd_load(int sw) {
+  (void) sw;
+  idle_report();
+  sched_report(); //run time and deadline misses of the game, clock and LED tasks (labmain.c)
+}
+
+static void cmd_travel(int sw) {
+  unsigned to = (unsigned) sw >> CMD_ROOM_SHIFT;
+  int dir, steps = 0;
+
+  if (to >= NUM_ROOMS) {
+    print("There is no such room.\n");
+    return;
+  }
+  //follow the route one step at a time, without printing the rooms on the way
+  while ((dir = route_next(game.room, to)) >= 0) {
+    game.room = room_exits[game.room][dir];
+    steps++;
+  }
+  if (dir == ROUTE_NONE) {
+    print("You can't get there from here.\n");
+    return;
+  }
+  if (steps == 0) {
+    print("You are already there.\n");
+    return;
+  }
+  print("You walk ");
+  print_dec(steps);
+  print(steps == 1 ? " step.\n" : " steps.\n");
+  print_room(to);
+}
+
+#ifdef PROFILE
+static void cmd_profile(int sw) {
+  (void) sw;
+  prof_dump();
+}
+#endif
+
+static void cmd_save(int sw) {
+  (void) sw;
+  save_dump();
+}
+
+static void cmd_reset(int sw) {
+  (void) sw;
+  print("Soft reset, the game comes back from the last save.\n");
+  soft_reset();
+}
+
+static void cmd_invalid(int sw) {
+  (void) sw;
+  print("No action using this switch combo.\n");
+}
+
+static const command_fn commands[NUM_COMMANDS] = {
+  [0 ... NUM_COMMANDS - 1] = cmd_invalid,                 //everything not registered below
+  [CMD(CMD_GO, 0)   ... CMD(CMD_GO, 3)]   = cmd_go,
+  [CMD(CMD_TAKE, 0)] = cmd_take,                         //the item is on SW9..SW5
+  [CMD(CMD_USE, 0)]  = cmd_use,
+  [CMD(CMD_OTHER, 0)] = cmd_look,
+  [CMD(CMD_OTHER, 1)] = cmd_inventory,
+  [CMD(CMD_OTHER, 2)] = cmd_load,
+  [CMD_TRAVEL]        = cmd_travel,
+  [CMD_SAVE]          = cmd_save,
+  [CMD_RESET]         = cmd_reset,
+#ifdef PROFILE
+  [CMD(CMD_OTHER, 3)] = cmd_profile,
+#endif
+};
+
+void run_switch_command(int switches) {
+  int sw = switches & 0x3FF; // the switches as they were when the button went down
+  moves++;
+  commands[sw & (NUM_COMMANDS - 1)](sw);
+}
+
+/*TYPED COMMANDS
+The same commands can also be typed in the terminal ("go north", "take the brass key", "i").
+parser.c turns a line into the code the switches would give, so it runs through the same
+table and the same handlers.*/
+void run_text_command(const char *line, unsigned len) {
+  struct lstr word;
+  int code = parse_command(line, len, &word);
+
+  if (code >= 0) {
+    moves++;
+    commands[code & (NUM_COMMANDS - 1)](code);
+  } else if (code == PARSE_UNKNOWN) {
+    print("I don't know the word \"");
+    print_n(word.s, word.len);
+    print("\".\n");
+  } else if (code == PARSE_WHAT) {
+    print("What? Try \"go north\", \"take flashlight\", \"use silver key\", \"travel 2\", \"look\" or \"inventory\".\n");
+  }
+  print_lit("> ");
+}
+
+
+#ifdef PRINT_BENCH
+/*Before/after numbers for the bulk UART writer: prints all nine room descriptions
+three ways and reports the mcycle count of each. Must run before uart_init so the
+first two runs go straight to the hardware FIFO.
+- printc per character: the old print, one JTAG_CTRL read per byte
+- print_n: one JTAG_CTRL read per burst of free FIFO slots
+- print_n into the ring (after uart_init): what the game loop actually pays*/
+static unsigned print_rooms_cycles(int per_char) {
+  unsigned start = read_mcycle();
+  for (int i = 0; i < NUM_ROOMS; i++) {
+    if (per_char) {
+      for (unsigned k = 0; k < rooms[i].desc.len; k++) printc(rooms[i].desc.s[k]);
+    } else {
+      print_n(rooms[i].desc.s, rooms[i].desc.len);
+    }
+  }
+  return read_mcycle() - start;
+}
+
+void print_bench(void) {
+  unsigned old_cycles = print_rooms_cycles(1);
+  unsigned bulk_cycles = print_rooms_cycles(0);
+  uart_init();
+  unsigned ring_cycles = print_rooms_cycles(0);
+  uart_flush();
+
+  print("\nprintc per char: "); print_dec(old_cycles);
+  print(" cycles\nprint_n polled:   "); print_dec(bulk_cycles);
+  print(" cycles\nprint_n ring:     "); print_dec(ring_cycles);
+  print(" cycles\n");
+}
+#endif
+
+#ifdef ITEM_BENCH
+/*Item dispatch cost, table-driven engine vs the old hard-coded if-chains. The old code is
+rebuilt here in its original shape (a branch per item, one bool per item and room) minus the
+printing, so only the dispatch and the state update are timed. Each round does one take that
+misses and one use of every item. Build with -DITEM_BENCH.*/
+#define ITEM_BENCH_ROUNDS 1000
+
+static struct {
+  bool has_flashlight, has_silver_key, has_brass_key, flashlight_on;
+  bool item_flashlight[NUM_ROOMS], item_silver_key[NUM_ROOMS], item_brass_key[NUM_ROOMS];
+  bool locked[NUM_ROOMS];
+} old;
+
+static int old_take(int item) {
+  int r = game.room;
+  if (item == 0) {
+    if (old.item_flashlight[r]) { old.item_flashlight[r] = 0; old.has_flashlight = 1; return 1; }
+    return 0;
+  }
+  if (item == 1) {
+    if (old.item_silver_key[r]) { old.item_silver_key[r] = 0; old.has_silver_key = 1; return 1; }
+    return 0;
+  }
+  if (item == 2) {
+    if (old.item_brass_key[r]) { old.item_brass_key[r] = 0; old.has_brass_key = 1; return 1; }
+    return 0;
+  }
+  return 0;
+}
+
+static int old_use(int item) {
+  const int16_t *exits = room_exits[game.room];
+  if (item == 0) {
+    if (!old.has_flashlight) return USE_NOT_CARRIED;
+    old.flashlight_on = !old.flashlight_on;
+    return old.flashlight_on ? USE_LIGHT_ON : USE_LIGHT_OFF;
+  }
+  if (item == 1) {
+    if (!old.has_silver_key) return USE_NOT_CARRIED;
+    if (exits[0] == 7 || exits[1] == 7 || exits[2] == 7 || exits[3] == 7) {
+      old.locked[7] = 0;
+      return USE_UNLOCKED;
+    }
+    return USE_NO_DOOR;
+  }
+  if (item == 2) {
+    if (!old.has_brass_key) return USE_NOT_CARRIED;
+    if (exits[0] == 8 || exits[1] == 8 || exits[2] == 8 || exits[3] == 8) {
+      old.locked[8] = 0;
+      return USE_UNLOCKED;
+    }
+    return USE_NO_DOOR;
+  }
+  return USE_NOT_CARRIED;
+}
+
+static volatile int item_sink;
+
+void item_bench(void) {
+  init_world();
+  game.room = 2;                                  //Kitchen: no items, next to the Storage Room
+  game.inventory = ITEM_BIT(0) | ITEM_BIT(1) | ITEM_BIT(2);
+  old.has_flashlight = old.has_silver_key = old.has_brass_key = 1;
+
+  unsigned t0 = read_mcycle();
+  for (int i = 0; i < ITEM_BENCH_ROUNDS; i++) {
+    for (int item = 0; item < 3; item++) {
+      item_sink = old_take(item);
+      item_sink = old_use(item);
+    }
+  }
+  unsigned t1 = read_mcycle();
+  for (int i = 0; i < ITEM_BENCH_ROUNDS; i++) {
+    for (int item = 0; item < 3; item++) {
+      item_sink = take_item(&game, item);
+      item_sink = use_item(&game, item);
+    }
+  }
+  unsigned t2 = read_mcycle();
+  init_world();
+
+  print("\nitem dispatch, cycles per take+use: if-chains ");
+  print_dec((t1 - t0) / (3 * ITEM_BENCH_ROUNDS));
+  print(", table ");
+  print_dec((t2 - t1) / (3 * ITEM_BENCH_ROUNDS));
+  print("\n");
+}
+#endif
+
+#ifdef GAME_EXPLORE
+/*STATE WORDS FOR THE EXPLORER
+host/explore.c (build with -DGAME_EXPLORE) searches every state the game can get into, and
+sees a state as one number: the fields of struct game_state next to each other,
+room | inventory | keys_used | light | locked. The items lying in the rooms are not stored,
+they follow from the inventory. The steps are the same rules the commands use, minus the text.*/
+#define PACK_INV    5                        //the room takes bits 0..4
+#define PACK_KEYS   (PACK_INV + NUM_ITEMS)
+#define PACK_LIGHT  (PACK_KEYS + NUM_ITEMS)
+#define PACK_LOCKED (PACK_LIGHT + 1)
+_Static_assert(NUM_ROOMS <= 32 && PACK_LOCKED + NUM_ROOMS <= 63, "a game state must fit in 63 bits");
+
+#define PACK_MASK(bits) (((uint64_t) 1 << (bits)) - 1)
+
+static uint64_t pack(const struct game_state *g) {
+  return g->room
+       | (uint64_t) g->inventory << PACK_INV
+       | (uint64_t) g->keys_used << PACK_KEYS
+       | (uint64_t) (g->flags & GAME_LIGHT_ON) << PACK_LIGHT
+       | (uint64_t) g->locked << PACK_LOCKED;
+}
+
+static void unpack(uint64_t s, struct game_state *g) {
+  g->room = s & PACK_MASK(PACK_INV);
+  g->inventory = (s >> PACK_INV) & PACK_MASK(NUM_ITEMS);
+  g->keys_used = (s >> PACK_KEYS) & PACK_MASK(NUM_ITEMS);
+  g->flags = (s >> PACK_LIGHT) & 1;
+  g->locked = (s >> PACK_LOCKED) & PACK_MASK(NUM_ROOMS);
+}
+
+uint64_t game_state_start(void) {
+  return pack(&new_game);
+}
+
+//What the command with this code (CMD(CMD_GO, dir), CMD_ITEM(CMD_TAKE, item) etc.) does to the state. Commands that only
+//print (look, inventory) or fail (locked door, no such item here) give back the same state.
+uint64_t game_state_step(uint64_t state, int code) {
+  struct game_state g;
+  int arg = code & 3, item = (unsigned) code >> CMD_ITEM_SHIFT;
+
+  unpack(state, &g);
+  switch (code & (NUM_COMMANDS - 1)) {
+  case CMD(CMD_GO, 0) ... CMD(CMD_GO, 3): {
+    int to = room_exits[g.room][arg];
+    if (to == -1 || enter_check(&g, to) != ENTER_OK) return state;
+    g.room = to;
+    break;
+  }
+  case CMD(CMD_TAKE, 0):
+    if (item >= NUM_ITEMS || !take_item(&g, item)) return state;
+    break;
+  case CMD(CMD_USE, 0):
+    if (item >= NUM_ITEMS) return state;
+    use_item(&g, item);
+    break;
+  default:
+    return state;
+  }
+  return pack(&g);
+}
+
+int game_state_won(uint64_t state) {
+  struct game_state g;
+  unpack(state, &g);
+  return game_won(&g);
+}
+
+unsigned game_state_room(uint64_t state) {
+  return state & PACK_MASK(PACK_INV);
+}
+
+unsigned game_num_rooms(void) { return NUM_ROOMS; }
+unsigned game_num_items(void) { return NUM_ITEMS; }
+const char *game_room_name(unsigned room) { return rooms[room].name.s; }
+const char *game_item_name(unsigned item) { return items[item].name.s; }
+#endif
+
+//Start a new game and show where the player stands
+void game_init(void) {
+  init_world();
+}
+
+void game_begin(void) {
+  update_status_leds(); //no items at the start (or the ones of a restored game)
+  enter_room(game.room);
+}
+
+//The LEDs of the carried items, so labmain.c's LED animation can draw around them
+unsigned game_leds(void) {
+  return led_mask;
+}
+
+//Where the player is and how many commands they gave, for the marquee on the HEX displays
+const char *game_room_title(void) {
+  return rooms[game.room].name.s;
+}
+
+unsigned game_moves(void) {
+  return moves;
+}
+
+/*SAVING
+A saved game is the five words of struct game_state plus the move count. led_mask and the
+routes follow from those, game_restore rebuilds them. save.c wraps the words in a record with
+a CRC and keeps it where a soft reset doesn't touch it.*/
+void game_save(unsigned out[GAME_SAVE_WORDS]) {
+  out[0] = game.room;
+  out[1] = game.inventory;
+  out[2] = game.keys_used;
+  out[3] = game.flags;
+  out[4] = game.locked;
+  out[5] = moves;
+}
+
+//The doors that are open once these keys have been used: a door opens when all its keys are used
+static unsigned doors_opened(item_mask_t keys_used) {
+  unsigned open = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (items[i].kind == ITEM_KEY) open |= ROOM_BIT(items[i].unlocks);
+  }
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (items[i].kind == ITEM_KEY && !(keys_used & ITEM_BIT(i))) open &= ~ROOM_BIT(items[i].unlocks);
+  }
+  return open;
+}
+
+//Returns 0 (and changes nothing) if the words can't be a game of this world: besides the ranges,
+//the state must be one play could reach. Only carried keys can have been used, the light is only
+//on while a light is carried, and exactly the doors whose keys were all used are open.
+int game_restore(const unsigned in[GAME_SAVE_WORDS]) {
+  item_mask_t keys = 0, lights = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (items[i].kind == ITEM_KEY) keys |= ITEM_BIT(i);
+    if (items[i].kind == ITEM_LIGHT) lights |= ITEM_BIT(i);
+  }
+  //every item bit set; a shift by the full width would be undefined at 32 (or 64) items
+  item_mask_t all_items = (item_mask_t) -1 >> (8 * sizeof(item_mask_t) - NUM_ITEMS);
+  if (in[0] >= NUM_ROOMS || (in[1] & ~all_items) || (in[2] & ~(in[1] & keys)) ||
+      (in[3] & ~GAME_LIGHT_ON) || ((in[3] & GAME_LIGHT_ON) && !(in[1] & lights)) ||
+      in[4] != (new_game.locked & ~doors_opened(in[2]))) {
+    return 0;
+  }
+  game.room = in[0];
+  game.inventory = in[1];
+  game.keys_used = in[2];
+  game.flags = in[3];
+  game.locked = in[4];
+  moves = in[5];
+
+  led_mask = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if ((game.inventory & ITEM_BIT(i)) && items[i].led >= 0) led_mask |= 1u << items[i].led;
+  }
+  route_sync(); //only the routes through rooms that differ from a new game are redone
+  return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef GAME_H
+#define GAME_H
+
+/* The Mystery House game (game.c), without any board code: labmain.c runs
+   it on the DTEK-V, host/game-host.c runs it natively from a script. */
+
+void game_init(void);
+void game_begin(void);
+void run_switch_command(int switches);
+void run_text_command(const char *line, unsigned len);
+int check_end(void);
+unsigned game_leds(void);
+const char *game_room_title(void);
+unsigned game_moves(void);
+
+/* The running game as GAME_SAVE_WORDS words, for the saved game in save.c */
+#define GAME_SAVE_WORDS 6
+void game_save(unsigned out[GAME_SAVE_WORDS]);
+int game_restore(const unsigned in[GAME_SAVE_WORDS]);
+
+#ifdef GAME_EXPLORE
+/* The rules on a state packed into one word, for host/explore.c.
+   code is a command code from parser.h: CMD(CMD_GO, dir), CMD_ITEM(CMD_TAKE, item), ... */
+#include <stdint.h>
+uint64_t game_state_start(void);
+uint64_t game_state_step(uint64_t state, int code);
+int game_state_won(uint64_t state);
+unsigned game_state_room(uint64_t state);
+unsigned game_num_rooms(void);
+unsigned game_num_items(void);
+const char *game_room_name(unsigned room);
+const char *game_item_name(unsigned item);
+#endif
+
+#ifdef PRINT_BENCH
+void print_bench(void);
+#endif
+#ifdef ITEM_BENCH
+void item_bench(void);
+#endif
+
+#endif
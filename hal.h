@@ -0,0 +1,44 @@
+#ifndef HAL_H
+#define HAL_H
+
+/* Hardware abstraction for the LEDs, switches and button.
+   Board: inline MMIO accesses, as cheap as using the pointers directly.
+   Host (-DHAL_HOST): host/hal-host.c, LEDs go to memory and the switches
+   and button come from the input script.
+   Text output and input go through the dtekv-lib.h print functions and
+   uart_getc, which host/host-lib.c implements on the host. */
+
+#ifdef HAL_HOST
+
+void hal_set_leds(unsigned mask);
+unsigned hal_get_sw(void);
+unsigned hal_get_btn(void);
+
+#else
+
+/* Memory-mapped I/O from lab 3 */
+#define HAL_LEDS     ((volatile unsigned int*) 0x04000000)
+#define HAL_SWITCHES ((volatile unsigned int*) 0x04000010)
+#define HAL_BUTTONS  ((volatile unsigned int*) 0x040000d0)
+
+/* The 10 LEDs, only the lowest 10 bits are used */
+static inline void hal_set_leds(unsigned mask)
+{
+  *HAL_LEDS = mask & 0x3ff;
+}
+
+/* SW9..SW0 */
+static inline unsigned hal_get_sw(void)
+{
+  return *HAL_SWITCHES & 0x3ff;
+}
+
+/* 1 while the push button is down */
+static inline unsigned hal_get_btn(void)
+{
+  return *HAL_BUTTONS & 0x1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,901 @@
+/* dtekv-sim.c - RV32IM + Zicsr instruction-set simulator for the DTEK-V, runs
+   the main.elf the Makefile links (with dtekv-script.lds) on a PC.
+
+   usage: dtekv-sim [-q] [-s script] [-g ms] [-c cycles] [-t top] main.elf
+
+   Memory: 32 MiB of RAM at 0, as in the linker script, plus the peripherals
+   at their DTEK-V addresses: LEDs, switches and button (with the PIO
+   interrupt mask/edge-capture registers), the interval timer, the JTAG UART
+   and the six 7-segment displays. Reset starts at 4 (the "j _start" slot of
+   boot.S) with mtvec = 0, and traps work like on the board: mcause/mepc/mtval,
+   mstatus MIE/MPIE, mret and wfi, with direct or vectored mtvec (boot.S
+   switches to vectored mode first thing).
+
+   Instructions are decoded once into a table covering the executable
+   sections (stores into it drop the entry, so it is refilled on the next
+   fetch). The table also holds the per-instruction counts for the hot-spot
+   report, which adds them up per symbol of the ELF.
+
+   Cycles are an estimate, not a measurement: CYCLES_* below is a simple
+   in-order pipeline. mcycle, the timer and the "simulated time" all run on
+   it. Time spent in wfi skips straight to the next event and is reported as
+   idle.
+
+   The script (-s) uses the syntax of host/game-host.c, so the same scripts
+   play on both:
+     sw <hex>      set SW9..SW0
+     btn           hold the button down for HOLD ms
+     press <hex>   sw + btn
+     wait <ms>     nothing happens for a while
+     # ...         comment, empty lines are skipped
+   anything else is typed into the JTAG UART, followed by '\n'.
+   Events are -g ms (default 20) of simulated time apart, plenty for a
+   command to finish and for input.c to debounce. The run ends when main
+   returns, -g ms after the last event, or after -c cycles. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define RAM_SIZE   (32u << 20)
+#define CPU_HZ     30000000u       /* DTEK-V system clock, also the timer clock */
+#define RESET_PC   4
+
+/* Assumed cost of an instruction, in cycles */
+#define CYCLES_ALU    1
+#define CYCLES_LOAD   2            /* one load-use bubble */
+#define CYCLES_MUL    1
+#define CYCLES_DIV    33           /* iterative divider */
+#define CYCLES_TAKEN  2            /* extra for a taken branch or a jump (refetch) */
+#define CYCLES_TRAP   3            /* extra for entering a trap or mret */
+
+/* mcause of the DTEK-V interrupt sources */
+#define IRQ_TIMER    16
+#define IRQ_SWITCHES 17
+#define IRQ_BUTTONS  18
+#define IRQ_UART     19
+
+#define MSTATUS_MIE  0x8u
+#define MSTATUS_MPIE 0x80u
+#define MSTATUS_MPP  0x1800u
+
+#define HOLD_MS 20                 /* a btn keeps the button down this long */
+
+/* ---------------------------------------------------------------- decoding */
+
+enum op {
+  OP_DECODE,                       /* entry not decoded yet */
+  OP_LUI, OP_AUIPC, OP_JAL, OP_JALR,
+  OP_BEQ, OP_BNE, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU,
+  OP_LB, OP_LH, OP_LW, OP_LBU, OP_LHU, OP_SB, OP_SH, OP_SW,
+  OP_ADDI, OP_SLTI, OP_SLTIU, OP_XORI, OP_ORI, OP_ANDI, OP_SLLI, OP_SRLI, OP_SRAI,
+  OP_ADD, OP_SUB, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_SRA, OP_OR, OP_AND,
+  OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU, OP_DIV, OP_DIVU, OP_REM, OP_REMU,
+  OP_FENCE, OP_ECALL, OP_EBREAK, OP_MRET, OP_WFI,
+  OP_CSRRW, OP_CSRRS, OP_CSRRC, OP_CSRRWI, OP_CSRRSI, OP_CSRRCI,
+  OP_ILLEGAL
+};
+
+/* One decoded instruction. rd is 32 (a dummy register) when the instruction
+   writes x0, so the interpreter never has to check for it. */
+struct insn {
+  uint8_t op, rd, rs1, rs2;
+  int32_t imm;                     /* immediate, CSR number for the CSR ops */
+  uint32_t cost;
+  uint32_t word;
+  uint64_t count;                  /* times executed */
+  uint64_t extra;                  /* cycles on top of count * cost */
+};
+
+static int32_t imm_i(uint32_t w) { return (int32_t) w >> 20; }
+static int32_t imm_s(uint32_t w) { return ((int32_t) w >> 25 << 5) | ((w >> 7) & 0x1f); }
+
+static int32_t imm_b(uint32_t w)
+{
+  return ((int32_t) w >> 31 << 12) | ((w & 0x80) << 4) | ((w >> 20) & 0x7e0) | ((w >> 7) & 0x1e);
+}
+
+static int32_t imm_j(uint32_t w)
+{
+  return ((int32_t) w >> 31 << 20) | (w & 0xff000) | ((w >> 9) & 0x800) | ((w >> 20) & 0x7fe);
+}
+
+static void decode(uint32_t w, struct insn *d)
+{
+  unsigned f3 = (w >> 12) & 7, f7 = w >> 25;
+  int op = OP_ILLEGAL;
+
+  d->word = w;
+  d->rd = (w >> 7) & 0x1f;
+  d->rs1 = (w >> 15) & 0x1f;
+  d->rs2 = (w >> 20) & 0x1f;
+  d->imm = imm_i(w);
+  d->cost = CYCLES_ALU;
+
+  switch (w & 0x7f) {
+  case 0x37: op = OP_LUI;   d->imm = w & 0xfffff000; break;
+  case 0x17: op = OP_AUIPC; d->imm = w & 0xfffff000; break;
+  case 0x6f: op = OP_JAL;   d->imm = imm_j(w); break;
+  case 0x67: if (f3 == 0) op = OP_JALR; break;
+  case 0x63:
+    d->imm = imm_b(w);
+    if (f3 != 2 && f3 != 3)
+      op = OP_BEQ + (f3 < 2 ? f3 : f3 - 2);
+    break;
+  case 0x03:
+    d->cost = CYCLES_LOAD;
+    if (f3 <= 2) op = OP_LB + f3;
+    else if (f3 == 4 || f3 == 5) op = OP_LBU + f3 - 4;
+    break;
+  case 0x23:
+    d->imm = imm_s(w);
+    if (f3 <= 2) op = OP_SB + f3;
+    break;
+  case 0x13:
+    switch (f3) {
+    case 0: op = OP_ADDI; break;
+    case 2: op = OP_SLTI; break;
+    case 3: op = OP_SLTIU; break;
+    case 4: op = OP_XORI; break;
+    case 6: op = OP_ORI; break;
+    case 7: op = OP_ANDI; break;
+    case 1: if (f7 == 0) op = OP_SLLI; d->imm &= 31; break;
+    case 5:
+      if (f7 == 0) op = OP_SRLI;
+      else if (f7 == 0x20) op = OP_SRAI;
+      d->imm &= 31;
+      break;
+    }
+    break;
+  case 0x33:
+    if (f7 == 0) {
+      static const uint8_t alu[8] = { OP_ADD, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_OR, OP_AND };
+      op = alu[f3];
+    } else if (f7 == 0x20 && (f3 == 0 || f3 == 5)) {
+      op = f3 == 0 ? OP_SUB : OP_SRA;
+    } else if (f7 == 1) {
+      op = OP_MUL + f3;
+      d->cost = f3 < 4 ? CYCLES_MUL : CYCLES_DIV;
+    }
+    break;
+  case 0x0f: op = OP_FENCE; break;
+  case 0x73:
+    d->imm = w >> 20;
+    if (f3 == 0) {
+      if (w == 0x00000073) op = OP_ECALL;
+      else if (w == 0x00100073) op = OP_EBREAK;
+      else if (w == 0x30200073) op = OP_MRET;
+      else if (w == 0x10500073) op = OP_WFI;
+    } else if (f3 != 4) {
+      op = OP_CSRRW + (f3 < 4 ? f3 - 1 : f3 - 2);
+    }
+    break;
+  }
+  d->op = op;
+  if (d->rd == 0)
+    d->rd = 32;
+}
+
+/* ------------------------------------------------------------------- state */
+
+static uint8_t *ram;
+static uint32_t x[33];             /* x[32] takes the writes to x0 */
+static uint32_t pc;
+static uint64_t cycle, instret, idle_cycles;
+
+static uint32_t mstatus, mie, mip, mtvec, mepc, mcause, mtval, mscratch;
+static uint64_t check_at;          /* cycle at which service() must run again */
+
+static struct insn *code;          /* decoded instructions for [0, code_end) */
+static uint32_t code_end;
+static struct insn slow;           /* fetches outside of it */
+
+static uint32_t main_addr, main_ret = 1;   /* 1: main has not been called yet */
+static int main_returned;
+static uint64_t limit = 60ull * CPU_HZ;    /* -c, one minute */
+static uint64_t stop_at = UINT64_MAX;      /* main returned or script over */
+
+/* ------------------------------------------------------------- peripherals */
+
+static unsigned leds, switches, button;
+static uint32_t hex[6];
+static unsigned sw_mask, sw_edge, btn_mask, btn_edge;
+
+static unsigned timer_status, timer_control, timer_period, timer_snap;
+static int timer_running;
+static uint64_t timer_next;        /* cycle of the next timeout */
+
+static unsigned uart_control;
+static char *rx_buf;
+static unsigned rx_head, rx_len, rx_cap;
+
+static int echo = 1;
+static uint32_t out_hash = 2166136261u;
+static unsigned long long out_bytes;
+
+static void uart_out(unsigned char c)
+{
+  out_hash = (out_hash ^ c) * 16777619u;
+  out_bytes++;
+  if (echo)
+    putchar(c);
+}
+
+static void uart_in(const char *s, unsigned len)
+{
+  if (rx_len + len > rx_cap) {
+    rx_cap = (rx_len + len) * 2;
+    rx_buf = realloc(rx_buf, rx_cap);
+  }
+  memmove(rx_buf, rx_buf + rx_head, rx_len);
+  rx_head = 0;
+  memcpy(rx_buf + rx_len, s, len);
+  rx_len += len;
+}
+
+/* Timeouts up to now. Continuous mode reloads, one-shot stops. */
+static void timer_sync(void)
+{
+  if (!timer_running || cycle < timer_next)
+    return;
+  timer_status |= 1;
+  uint64_t period = timer_period + 1ull;
+  if (timer_control & 2)
+    timer_next += (cycle - timer_next) / period * period + period;
+  else
+    timer_running = 0;
+}
+
+static void update_mip(void)
+{
+  timer_sync();
+  mip = 0;
+  if ((timer_status & 1) && (timer_control & 1))
+    mip |= 1u << IRQ_TIMER;
+  if (sw_edge & sw_mask)
+    mip |= 1u << IRQ_SWITCHES;
+  if (btn_edge & btn_mask)
+    mip |= 1u << IRQ_BUTTONS;
+  if ((uart_control & 2) || ((uart_control & 1) && rx_len != 0))   /* WSPACE never runs out */
+    mip |= 1u << IRQ_UART;
+}
+
+static void set_switches(unsigned v)
+{
+  sw_edge |= (v ^ switches) & 0x3ff;
+  switches = v & 0x3ff;
+  check_at = 0;
+}
+
+static void set_button(unsigned v)
+{
+  if (v && !button)
+    btn_edge |= 1;
+  button = v;
+  check_at = 0;
+}
+
+static uint32_t mmio_read(uint32_t a)
+{
+  switch (a) {
+  case 0x04000000: return leds;
+  case 0x04000010: return switches;
+  case 0x04000018: return sw_mask;
+  case 0x0400001c: return sw_edge;
+  case 0x04000020: timer_sync(); return timer_status | timer_running << 1;
+  case 0x04000024: return timer_control;
+  case 0x04000028: return timer_period & 0xffff;
+  case 0x0400002c: return timer_period >> 16;
+  case 0x04000030: return timer_snap & 0xffff;
+  case 0x04000034: return timer_snap >> 16;
+  case 0x04000040: {
+    if (rx_len == 0)
+      return 0;
+    unsigned c = (unsigned char) rx_buf[rx_head++];
+    rx_len--;
+    check_at = 0;
+    return (rx_len > 0xffff ? 0xffff : rx_len) << 16 | 0x8000 | c;
+  }
+  case 0x04000044:
+    return 64u << 16 | (uart_control & 3) | ((uart_control & 1) && rx_len != 0) << 8 | (uart_control & 2) << 8;
+  case 0x040000d0: return button;
+  case 0x040000d8: return btn_mask;
+  case 0x040000dc: return btn_edge;
+  }
+  if (a >= 0x04000050 && a < 0x040000b0 && (a & 0xf) == 0)
+    return hex[(a - 0x04000050) >> 4];
+  return 0;
+}
+
+static void mmio_write(uint32_t a, uint32_t v)
+{
+  check_at = 0;                    /* may have changed what is pending */
+  switch (a) {
+  case 0x04000000: leds = v & 0x3ff; return;
+  case 0x04000018: sw_mask = v; return;
+  case 0x0400001c: sw_edge = 0; return;
+  case 0x04000020: timer_sync(); timer_status = 0; return;
+  case 0x04000024:
+    timer_sync();
+    timer_control = v & 3;
+    if (v & 8) {
+      timer_running = 0;
+    } else if (v & 4) {
+      timer_running = 1;
+      timer_next = cycle + timer_period + 1;
+    }
+    return;
+  case 0x04000028: timer_period = (timer_period & 0xffff0000) | (v & 0xffff); return;
+  case 0x0400002c: timer_period = (timer_period & 0xffff) | (v & 0xffff) << 16; return;
+  case 0x04000030:
+  case 0x04000034:
+    timer_snap = timer_running ? (uint32_t) (timer_next - cycle - 1) : timer_period;
+    return;
+  case 0x04000040: uart_out(v & 0xff); return;
+  case 0x04000044: uart_control = v & 3; return;
+  case 0x040000d8: btn_mask = v; return;
+  case 0x040000dc: btn_edge = 0; return;
+  }
+  if (a >= 0x04000050 && a < 0x040000b0 && (a & 0xf) == 0)
+    hex[(a - 0x04000050) >> 4] = v & 0xff;
+}
+
+/* ------------------------------------------------------------------ script */
+
+enum step_type { STEP_SW, STEP_BTN_DOWN, STEP_BTN_UP, STEP_TEXT, STEP_WAIT };
+
+struct step {
+  enum step_type type;
+  unsigned value;                  /* switches, or ms to wait */
+  const char *text;
+  unsigned len;
+};
+
+static struct step *steps;
+static unsigned num_steps, next_step;
+static uint64_t step_due;          /* cycle of the next step */
+static uint64_t gap_cycles = 20 * (CPU_HZ / 1000);
+
+static struct step *add_step(enum step_type type)
+{
+  static unsigned cap;
+  if (num_steps == cap) {
+    cap = cap ? 2 * cap : 64;
+    steps = realloc(steps, cap * sizeof(*steps));
+  }
+  struct step *s = &steps[num_steps++];
+  memset(s, 0, sizeof(*s));
+  s->type = type;
+  return s;
+}
+
+static void load_script(char *s)
+{
+  for (char *line = strtok(s, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")) {
+    while (*line == ' ' || *line == '\t')
+      line++;
+    if (*line == '\0' || *line == '#')
+      continue;
+    if (strncmp(line, "sw ", 3) == 0) {
+      add_step(STEP_SW)->value = strtoul(line + 3, NULL, 16);
+    } else if (strncmp(line, "wait ", 5) == 0) {
+      add_step(STEP_WAIT)->value = strtoul(line + 5, NULL, 0);
+    } else if (strcmp(line, "btn") == 0 || strncmp(line, "press ", 6) == 0) {
+      if (line[0] == 'p')
+        add_step(STEP_SW)->value = strtoul(line + 6, NULL, 16);
+      add_step(STEP_BTN_DOWN);
+      add_step(STEP_BTN_UP);
+    } else {
+      size_t len = strlen(line);
+      line[len] = '\n';            /* strtok already cut the line there */
+      struct step *t = add_step(STEP_TEXT);
+      t->text = line;
+      t->len = len + 1;
+    }
+  }
+}
+
+/* Runs the next step once it is due */
+static void script_step(void)
+{
+  if (next_step == num_steps || cycle < step_due)
+    return;
+  const struct step *s = &steps[next_step++];
+  uint64_t wait = gap_cycles;
+  switch (s->type) {
+  case STEP_SW:       set_switches(s->value); break;
+  case STEP_BTN_DOWN: set_button(1); wait = HOLD_MS * (CPU_HZ / 1000); break;
+  case STEP_BTN_UP:   set_button(0); break;
+  case STEP_TEXT:     uart_in(s->text, s->len); check_at = 0; break;
+  case STEP_WAIT:     wait = (uint64_t) s->value * (CPU_HZ / 1000); break;
+  }
+  step_due = cycle + wait;
+  if (next_step == num_steps && !main_returned)
+    stop_at = step_due;
+}
+
+/* -------------------------------------------------------------------- traps */
+
+static void trap(uint32_t cause, uint32_t epc, uint32_t tval)
+{
+  mepc = epc;
+  mcause = cause;
+  mtval = tval;
+  mstatus = (mstatus & ~(MSTATUS_MIE | MSTATUS_MPIE)) | (mstatus & MSTATUS_MIE) << 4 | MSTATUS_MPP;
+  pc = mtvec & ~3u;
+  if ((mtvec & 1) && (cause & 0x80000000u))
+    pc += 4 * (cause & 0x7fffffff);
+  cycle += CYCLES_TRAP;
+  check_at = 0;
+}
+
+static void exception(uint32_t cause, uint32_t tval)
+{
+  if (cause != 11) {
+    static unsigned reported;
+    if (reported++ < 10)
+      fprintf(stderr, "dtekv-sim: exception %u at pc %08x (mtval %08x)\n", cause, pc, tval);
+  }
+  trap(cause, pc, tval);
+}
+
+/* Runs at check_at: script steps, timer timeouts, pending interrupts.
+   Sets check_at to the next time something happens. */
+static void service(void)
+{
+  script_step();
+  update_mip();
+  check_at = timer_running ? timer_next : UINT64_MAX;
+  if (next_step < num_steps && step_due < check_at)
+    check_at = step_due;
+  if (stop_at < check_at)
+    check_at = stop_at;
+  if (limit < check_at)
+    check_at = limit;
+  uint32_t pending = mip & mie;
+  if (pending != 0 && (mstatus & MSTATUS_MIE))
+    trap(0x80000000u | __builtin_ctz(pending), pc, 0);
+}
+
+static uint32_t csr_read(unsigned csr, int *ok)
+{
+  switch (csr) {
+  case 0x300: return mstatus;
+  case 0x301: return 0x40001100;   /* RV32 I M */
+  case 0x304: return mie;
+  case 0x305: return mtvec;
+  case 0x340: return mscratch;
+  case 0x341: return mepc;
+  case 0x342: return mcause;
+  case 0x343: return mtval;
+  case 0x344: update_mip(); return mip;
+  case 0xb00: case 0xc00: return (uint32_t) cycle;
+  case 0xb02: case 0xc02: return (uint32_t) instret;
+  case 0xb80: case 0xc80: return cycle >> 32;
+  case 0xb82: case 0xc82: return instret >> 32;
+  case 0xf11: case 0xf12: case 0xf13: case 0xf14: return 0;
+  }
+  *ok = 0;
+  return 0;
+}
+
+static void csr_write(unsigned csr, uint32_t v)
+{
+  switch (csr) {
+  case 0x300: mstatus = (v & (MSTATUS_MIE | MSTATUS_MPIE)) | MSTATUS_MPP; break;
+  case 0x304: mie = v; break;
+  case 0x305: mtvec = v & ~2u; break;
+  case 0x340: mscratch = v; break;
+  case 0x341: mepc = v & ~3u; break;
+  case 0x342: mcause = v; break;
+  case 0x343: mtval = v; break;
+  case 0xb00: cycle = (cycle & ~0xffffffffull) | v; break;
+  case 0xb02: instret = (instret & ~0xffffffffull) | v; break;
+  }
+  check_at = 0;
+}
+
+/* --------------------------------------------------------------------- run */
+
+static struct insn *fetch(void)
+{
+  if (pc < code_end) {
+    struct insn *d = &code[pc >> 2];
+    if (d->op == OP_DECODE)
+      decode(*(uint32_t *) (ram + pc), d);
+    return d;
+  }
+  if (pc > RAM_SIZE - 4)
+    return NULL;
+  decode(*(uint32_t *) (ram + pc), &slow);
+  return &slow;
+}
+
+/* Stores into the decoded range drop the entries they touch */
+static inline void code_written(uint32_t a, unsigned size)
+{
+  if (a < code_end) {
+    code[a >> 2].op = OP_DECODE;
+    if (((a + size - 1) >> 2) < (code_end >> 2))
+      code[(a + size - 1) >> 2].op = OP_DECODE;
+  }
+}
+
+/* A taken branch or jump to t. Misaligned targets trap at the branch. */
+#define JUMP(t) do { uint32_t t_ = (t); \
+    if (t_ & 3) { exception(0, t_); goto next; } \
+    next_pc = t_; cycle += CYCLES_TAKEN; d->extra += CYCLES_TAKEN; } while (0)
+
+#define LOAD(type, conv) do { uint32_t a = x[d->rs1] + d->imm; \
+    if (a <= RAM_SIZE - sizeof(type)) { type v_; memcpy(&v_, ram + a, sizeof(type)); x[d->rd] = conv v_; } \
+    else if ((a >> 12) == 0x04000) x[d->rd] = conv (type) (mmio_read(a & ~3u) >> 8 * (a & 3)); \
+    else { exception(5, a); goto next; } } while (0)
+
+#define STORE(type) do { uint32_t a = x[d->rs1] + d->imm; type v_ = x[d->rs2]; \
+    if (a <= RAM_SIZE - sizeof(type)) { memcpy(ram + a, &v_, sizeof(type)); code_written(a, sizeof(type)); } \
+    else if ((a >> 12) == 0x04000) mmio_write(a & ~3u, v_); \
+    else { exception(7, a); goto next; } } while (0)
+
+/* Runs until main returns (plus a moment for the UART interrupt to drain
+   its queue), the script is over, the program can't wake up again or the
+   cycle limit. Returns why it stopped. */
+static const char *run(void)
+{
+  for (;;) {
+    if (cycle >= check_at) {
+      if (cycle >= limit)
+        return "cycle limit";
+      if (cycle >= stop_at)
+        return main_returned ? "main returned" : "end of script";
+      service();
+    }
+
+    struct insn *d = fetch();
+    if (d == NULL) {
+      exception(1, pc);
+      continue;
+    }
+    d->count++;
+    instret++;
+    cycle += d->cost;
+    uint32_t next_pc = pc + 4;
+
+    switch (d->op) {
+    case OP_LUI:   x[d->rd] = d->imm; break;
+    case OP_AUIPC: x[d->rd] = pc + d->imm; break;
+    case OP_JAL:
+      JUMP(pc + d->imm);
+      x[d->rd] = pc + 4;
+      if (next_pc == main_addr && main_addr != 0 && main_ret == 1) {
+        main_ret = pc + 4;
+        check_at = 0;
+      }
+      break;
+    case OP_JALR: {
+      uint32_t t = (x[d->rs1] + d->imm) & ~1u;
+      JUMP(t);
+      x[d->rd] = pc + 4;
+      if (t == main_ret && !main_returned) {
+        main_returned = 1;
+        stop_at = cycle + CPU_HZ / 100;
+        check_at = 0;
+      }
+      break;
+    }
+    case OP_BEQ:  if (x[d->rs1] == x[d->rs2]) JUMP(pc + d->imm); break;
+    case OP_BNE:  if (x[d->rs1] != x[d->rs2]) JUMP(pc + d->imm); break;
+    case OP_BLT:  if ((int32_t) x[d->rs1] < (int32_t) x[d->rs2]) JUMP(pc + d->imm); break;
+    case OP_BGE:  if ((int32_t) x[d->rs1] >= (int32_t) x[d->rs2]) JUMP(pc + d->imm); break;
+    case OP_BLTU: if (x[d->rs1] < x[d->rs2]) JUMP(pc + d->imm); break;
+    case OP_BGEU: if (x[d->rs1] >= x[d->rs2]) JUMP(pc + d->imm); break;
+    case OP_LB:  LOAD(int8_t, (int32_t)); break;
+    case OP_LH:  LOAD(int16_t, (int32_t)); break;
+    case OP_LW:  LOAD(uint32_t, ); break;
+    case OP_LBU: LOAD(uint8_t, ); break;
+    case OP_LHU: LOAD(uint16_t, ); break;
+    case OP_SB:  STORE(uint8_t); break;
+    case OP_SH:  STORE(uint16_t); break;
+    case OP_SW:  STORE(uint32_t); break;
+    case OP_ADDI:  x[d->rd] = x[d->rs1] + d->imm; break;
+    case OP_SLTI:  x[d->rd] = (int32_t) x[d->rs1] < d->imm; break;
+    case OP_SLTIU: x[d->rd] = x[d->rs1] < (uint32_t) d->imm; break;
+    case OP_XORI:  x[d->rd] = x[d->rs1] ^ d->imm; break;
+    case OP_ORI:   x[d->rd] = x[d->rs1] | d->imm; break;
+    case OP_ANDI:  x[d->rd] = x[d->rs1] & d->imm; break;
+    case OP_SLLI:  x[d->rd] = x[d->rs1] << d->imm; break;
+    case OP_SRLI:  x[d->rd] = x[d->rs1] >> d->imm; break;
+    case OP_SRAI:  x[d->rd] = (int32_t) x[d->rs1] >> d->imm; break;
+    case OP_ADD:  x[d->rd] = x[d->rs1] + x[d->rs2]; break;
+    case OP_SUB:  x[d->rd] = x[d->rs1] - x[d->rs2]; break;
+    case OP_SLL:  x[d->rd] = x[d->rs1] << (x[d->rs2] & 31); break;
+    case OP_SLT:  x[d->rd] = (int32_t) x[d->rs1] < (int32_t) x[d->rs2]; break;
+    case OP_SLTU: x[d->rd] = x[d->rs1] < x[d->rs2]; break;
+    case OP_XOR:  x[d->rd] = x[d->rs1] ^ x[d->rs2]; break;
+    case OP_SRL:  x[d->rd] = x[d->rs1] >> (x[d->rs2] & 31); break;
+    case OP_SRA:  x[d->rd] = (int32_t) x[d->rs1] >> (x[d->rs2] & 31); break;
+    case OP_OR:   x[d->rd] = x[d->rs1] | x[d->rs2]; break;
+    case OP_AND:  x[d->rd] = x[d->rs1] & x[d->rs2]; break;
+    case OP_MUL:    x[d->rd] = x[d->rs1] * x[d->rs2]; break;
+    case OP_MULH:   x[d->rd] = ((int64_t) (int32_t) x[d->rs1] * (int32_t) x[d->rs2]) >> 32; break;
+    case OP_MULHSU: x[d->rd] = ((int64_t) (int32_t) x[d->rs1] * (uint64_t) x[d->rs2]) >> 32; break;
+    case OP_MULHU:  x[d->rd] = ((uint64_t) x[d->rs1] * x[d->rs2]) >> 32; break;
+    case OP_DIV: {
+      int32_t a = x[d->rs1], b = x[d->rs2];
+      x[d->rd] = b == 0 ? -1 : (a == INT32_MIN && b == -1) ? a : a / b;
+      break;
+    }
+    case OP_DIVU: x[d->rd] = x[d->rs2] == 0 ? 0xffffffffu : x[d->rs1] / x[d->rs2]; break;
+    case OP_REM: {
+      int32_t a = x[d->rs1], b = x[d->rs2];
+      x[d->rd] = b == 0 ? a : (a == INT32_MIN && b == -1) ? 0 : a % b;
+      break;
+    }
+    case OP_REMU: x[d->rd] = x[d->rs2] == 0 ? x[d->rs1] : x[d->rs1] % x[d->rs2]; break;
+    case OP_FENCE: break;
+    case OP_ECALL:  exception(11, 0); goto next;
+    case OP_EBREAK: exception(3, pc); goto next;
+    case OP_MRET:
+      mstatus = (mstatus & ~MSTATUS_MIE) | (mstatus & MSTATUS_MPIE) >> 4 | MSTATUS_MPIE;
+      next_pc = mepc;
+      cycle += CYCLES_TRAP;
+      d->extra += CYCLES_TRAP;
+      check_at = 0;
+      break;
+    case OP_WFI: {
+      /* sleep until an enabled interrupt is pending (even with MIE clear),
+         skipping from one event to the next. An interrupt taken here
+         returns after the wfi. */
+      uint64_t t0 = cycle;
+      pc = next_pc;
+      for (;;) {
+        service();
+        if ((mip & mie) || cycle >= limit || cycle >= stop_at)
+          break;
+        if (check_at == UINT64_MAX)
+          return "program sleeps forever";
+        cycle = check_at;
+      }
+      idle_cycles += cycle - t0;
+      check_at = 0;
+      goto next;
+    }
+    case OP_CSRRW: case OP_CSRRS: case OP_CSRRC:
+    case OP_CSRRWI: case OP_CSRRSI: case OP_CSRRCI: {
+      int ok = 1, kind = (d->op - OP_CSRRW) % 3;
+      uint32_t src = d->op >= OP_CSRRWI ? d->rs1 : x[d->rs1];
+      uint32_t old = csr_read(d->imm, &ok);
+      if (!ok) {
+        exception(2, d->word);
+        goto next;
+      }
+      if (kind == 0)
+        csr_write(d->imm, src);
+      else if (d->rs1 != 0)
+        csr_write(d->imm, kind == 1 ? old | src : old & ~src);
+      x[d->rd] = old;
+      break;
+    }
+    default:
+      exception(2, d->word);
+      goto next;
+    }
+    pc = next_pc;
+  next:;
+  }
+}
+
+/* ------------------------------------------------------------------- ELF */
+
+struct sym {
+  uint32_t addr;
+  const char *name;
+  uint64_t count, cycles;
+};
+
+static struct sym *syms;
+static unsigned num_syms;
+
+static int by_addr(const void *a, const void *b)
+{
+  const struct sym *p = a, *q = b;
+  return p->addr < q->addr ? -1 : p->addr > q->addr;
+}
+
+static int by_cycles(const void *a, const void *b)
+{
+  const struct sym *p = a, *q = b;
+  return p->cycles < q->cycles ? 1 : p->cycles > q->cycles ? -1 : 0;
+}
+
+static uint32_t rd32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static uint16_t rd16(const uint8_t *p) { uint16_t v; memcpy(&v, p, 2); return v; }
+
+static void fail(const char *name, const char *why)
+{
+  fprintf(stderr, "dtekv-sim: %s: %s\n", name, why);
+  exit(1);
+}
+
+/* Loads the PT_LOAD segments into RAM, finds the executable sections (the
+   decoded range) and collects the code symbols: functions, and the labels of
+   the assembly files that have no type. */
+static void load_elf(const char *name)
+{
+  FILE *f = fopen(name, "rb");
+  if (f == NULL) {
+    perror(name);
+    exit(1);
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *e = malloc(size);
+  if (fread(e, 1, size, f) != (size_t) size)
+    fail(name, "read error");
+  fclose(f);
+
+  if (size < 52 || memcmp(e, "\177ELF\1\1", 6) != 0 || rd16(e + 18) != 243)
+    fail(name, "not a 32-bit little-endian RISC-V ELF file");
+
+  uint32_t phoff = rd32(e + 28), shoff = rd32(e + 32);
+  unsigned phnum = rd16(e + 44), shnum = rd16(e + 48);
+  for (unsigned i = 0; i < phnum; i++) {
+    const uint8_t *ph = e + phoff + 32 * i;
+    uint32_t off = rd32(ph + 4), vaddr = rd32(ph + 8), filesz = rd32(ph + 16), memsz = rd32(ph + 20);
+    if (rd32(ph) != 1)
+      continue;
+    if (vaddr + memsz > RAM_SIZE || off + filesz > (uint32_t) size)
+      fail(name, "segment outside of RAM");
+    memcpy(ram + vaddr, e + off, filesz);
+  }
+
+  uint8_t *is_code = calloc(shnum, 1);
+  const uint8_t *symtab = NULL;
+  for (unsigned i = 0; i < shnum; i++) {
+    const uint8_t *sh = e + shoff + 40 * i;
+    if (rd32(sh + 8) & 4) {        /* SHF_EXECINSTR */
+      is_code[i] = 1;
+      if (rd32(sh + 12) + rd32(sh + 20) > code_end)
+        code_end = (rd32(sh + 12) + rd32(sh + 20) + 3) & ~3u;
+    }
+    if (rd32(sh + 4) == 2)         /* SHT_SYMTAB */
+      symtab = sh;
+  }
+  code = calloc(code_end / 4 + 1, sizeof(*code));
+
+  if (symtab != NULL) {
+    const uint8_t *strsh = e + shoff + 40 * rd32(symtab + 24);
+    const char *strtab = (const char *) e + rd32(strsh + 16);
+    unsigned n = rd32(symtab + 20) / 16;
+    syms = calloc(n + 1, sizeof(*syms));
+    for (unsigned i = 0; i < n; i++) {
+      const uint8_t *s = e + rd32(symtab + 16) + 16 * i;
+      const char *sname = strtab + rd32(s);
+      unsigned type = s[12] & 15, shndx = rd16(s + 14);
+      if (shndx >= shnum || !is_code[shndx] || (type != 0 && type != 2))
+        continue;
+      if (sname[0] == '\0' || sname[0] == '$' || strncmp(sname, ".L", 2) == 0)
+        continue;
+      if (strcmp(sname, "main") == 0)
+        main_addr = rd32(s + 4);
+      syms[num_syms].addr = rd32(s + 4);
+      syms[num_syms++].name = sname;
+    }
+    qsort(syms, num_syms, sizeof(*syms), by_addr);
+  }
+  free(is_code);
+  /* e stays allocated, the symbol names point into it */
+}
+
+/* ------------------------------------------------------------------ report */
+
+static struct sym *find_sym(uint32_t addr)
+{
+  unsigned lo = 0, hi = num_syms;
+  while (lo < hi) {
+    unsigned mid = (lo + hi) / 2;
+    if (syms[mid].addr <= addr) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo ? &syms[lo - 1] : NULL;
+}
+
+static void report(const char *why, double secs, unsigned top)
+{
+  uint64_t busy = cycle - idle_cycles;
+
+  fflush(stdout);
+  fprintf(stderr, "\n== dtekv-sim: %s ==\n", why);
+  fprintf(stderr, "%llu instructions, %llu cycles (%llu busy, %llu idle in wfi), CPI %.2f\n",
+          (unsigned long long) instret, (unsigned long long) cycle,
+          (unsigned long long) busy, (unsigned long long) idle_cycles,
+          instret ? (double) busy / instret : 0.0);
+  fprintf(stderr, "simulated %.3f s at %u MHz in %.3f s host time, %.0f M instructions/s\n",
+          (double) cycle / CPU_HZ, CPU_HZ / 1000000, secs, secs > 0 ? instret / secs / 1e6 : 0.0);
+  fprintf(stderr, "UART %llu bytes, hash %08x; LEDs %03x; HEX5..HEX0 %02x %02x %02x %02x %02x %02x\n",
+          out_bytes, (unsigned) out_hash, leds, hex[5], hex[4], hex[3], hex[2], hex[1], hex[0]);
+
+  struct sym other = { 0, "(no symbol)", 0, 0 };
+  for (uint32_t i = 0; i < code_end / 4; i++) {
+    if (code[i].count == 0)
+      continue;
+    struct sym *s = find_sym(4 * i);
+    if (s == NULL)
+      s = &other;
+    s->count += code[i].count;
+    s->cycles += code[i].count * code[i].cost + code[i].extra;
+  }
+  qsort(syms, num_syms, sizeof(*syms), by_cycles);
+
+  fprintf(stderr, "\n%-24s %14s %14s %7s\n", "hot spots", "instructions", "cycles", "busy");
+  for (unsigned i = 0; i < num_syms + 1 && top != 0; i++) {
+    struct sym *s = i < num_syms ? &syms[i] : &other;
+    if (s->count == 0)
+      continue;
+    fprintf(stderr, "%-24s %14llu %14llu %6.2f%%\n", s->name, (unsigned long long) s->count,
+            (unsigned long long) s->cycles, busy ? 100.0 * s->cycles / busy : 0.0);
+    top--;
+  }
+}
+
+static char *read_file(const char *name)
+{
+  FILE *f = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+  if (f == NULL) {
+    perror(name);
+    exit(1);
+  }
+  size_t len = 0, cap = 4096;
+  char *s = malloc(cap);
+  size_t n;
+  while ((n = fread(s + len, 1, cap - len - 1, f)) > 0) {
+    len += n;
+    if (cap - len == 1)
+      s = realloc(s, cap *= 2);
+  }
+  s[len] = '\0';
+  if (f != stdin)
+    fclose(f);
+  return s;
+}
+
+int main(int argc, char **argv)
+{
+  const char *elf = NULL;
+  unsigned top = 15;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0)
+      echo = 0;
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      load_script(read_file(argv[++i]));
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+      gap_cycles = strtoull(argv[++i], NULL, 0) * (CPU_HZ / 1000);
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+      limit = strtoull(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      top = strtoul(argv[++i], NULL, 0);
+    else if (argv[i][0] != '-')
+      elf = argv[i];
+    else
+      elf = NULL, i = argc;
+  }
+  if (elf == NULL) {
+    fprintf(stderr, "usage: %s [-q] [-s script] [-g ms] [-c cycles] [-t top] main.elf\n", argv[0]);
+    return 2;
+  }
+
+  ram = calloc(RAM_SIZE, 1);
+  load_elf(elf);
+  pc = RESET_PC;
+  mstatus = MSTATUS_MPP;
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  const char *why = run();
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  report(why, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9, top);
+  return 0;
+}
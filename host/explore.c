@@ -0,0 +1,522 @@
+/* explore.c - searches every state a game can get into: breadth-first from
+   the start, over all go/take/use commands, so the first winning state found
+   is reached by a shortest winning command sequence.
+
+   usage: explore [-j threads] [-m max_states] [-o script] [-w rooms keys seed]
+
+   Without -w it explores Mystery House through the rules in game.c (built
+   with -DGAME_EXPLORE). -w explores a world from world.c with the same rules:
+   keys are taken in their room and used next to their door, dark rooms need
+   the light switched on, the goal is the last locked door.
+
+   A state is one packed word. Visited states are kept in an open-addressing
+   hash set (linear probing, filled with compare-and-swap so all threads
+   insert into the same set) and numbered in the order they are found, which
+   is level by level: the states of one BFS level are one range of numbers,
+   and the next level is whatever the threads add while expanding it. Each
+   state remembers its parent and the command that led to it.
+
+   Reported: number of states and transitions, the shortest winning sequence
+   (-o writes it as a script for game-host and dtekv-sim), rooms no state
+   ever stands in, and dead ends: states from which the game can't be won
+   any more. Memory: 37 bytes per state allowed by -m (13 for the state,
+   24 for the two hash slots it gets), plus 4 per transition and 5 per state
+   for the dead-end check. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "../game.h"
+#include "../parser.h"
+#include "../world.h"
+
+/* ------------------------------------------------------------------ models */
+
+struct model {
+  unsigned num_rooms;
+  unsigned num_moves;
+  uint64_t start;
+  uint64_t (*step)(uint64_t state, unsigned move);
+  int (*won)(uint64_t state);
+  unsigned (*room)(uint64_t state);
+  void (*name)(unsigned move, char *buf, size_t size);
+  const char *(*room_name)(unsigned room);   /* 0: rooms are only numbers */
+};
+
+static struct model m;
+
+static const char *const dir_names[4] = { "north", "south", "east", "west" };
+
+/* Mystery House: go in four directions, take and use every item */
+static int game_code(unsigned move)
+{
+  unsigned items = game_num_items();
+  if (move < 4)
+    return CMD(CMD_GO, move);
+  if (move < 4 + items)
+    return CMD_ITEM(CMD_TAKE, move - 4);
+  return CMD_ITEM(CMD_USE, move - 4 - items);
+}
+
+static uint64_t game_step(uint64_t state, unsigned move)
+{
+  return game_state_step(state, game_code(move));
+}
+
+static void game_name(unsigned move, char *buf, size_t size)
+{
+  int code = game_code(move);
+  if (move < 4)
+    snprintf(buf, size, "go %s", dir_names[move]);
+  else
+    snprintf(buf, size, "%s %s", code == CMD_ITEM(CMD_TAKE, move - 4) ? "take" : "use",
+             game_item_name((unsigned) code >> CMD_ITEM_SHIFT));
+}
+
+static void use_game(void)
+{
+  m.num_rooms = game_num_rooms();
+  m.num_moves = 4 + 2 * game_num_items();
+  m.start = game_state_start();
+  m.step = game_step;
+  m.won = game_state_won;
+  m.room = game_state_room;
+  m.name = game_name;
+  m.room_name = game_room_name;
+}
+
+/* Generated worlds. State: room | keys held | keys used | light held | light on.
+   Moves: 4 go, take key 0..k-1, take light, use key 0..k-1, use light. */
+static struct world w;
+static int16_t *door_key;          /* for a locked room, the key that opens it */
+static unsigned room_bits, held_at, used_at, light_at;
+
+static uint64_t world_step(uint64_t s, unsigned move)
+{
+  unsigned room = s & ((1u << room_bits) - 1), k = w.num_keys;
+  uint64_t held = s >> held_at, used = s >> used_at;
+
+  if (move < 4) {
+    int to = w.exits[room][move];
+    if (to < 0)
+      return s;
+    if (WORLD_HAS(w.locked, to) && !((used >> door_key[to]) & 1))
+      return s;
+    if (WORLD_HAS(w.dark, to) && !((s >> (light_at + 1)) & 1))
+      return s;
+    return (s & ~(uint64_t) ((1u << room_bits) - 1)) | (unsigned) to;
+  }
+  move -= 4;
+  if (move < k)                    /* take key */
+    return w.key_room[move] == (int) room ? s | (uint64_t) 1 << (held_at + move) : s;
+  if (move == k)                   /* take light */
+    return w.light_room == room ? s | (uint64_t) 1 << light_at : s;
+  move -= k + 1;
+  if (move < k) {                  /* use key */
+    int door = w.key_door[move];
+    const int16_t *e = w.exits[room];
+    if (!((held >> move) & 1) || (e[0] != door && e[1] != door && e[2] != door && e[3] != door))
+      return s;
+    return s | (uint64_t) 1 << (used_at + move);
+  }
+  return ((s >> light_at) & 1) ? s ^ (uint64_t) 1 << (light_at + 1) : s;   /* use light */
+}
+
+static int world_won(uint64_t s)
+{
+  return (s & ((1u << room_bits) - 1)) == w.goal;
+}
+
+static unsigned world_room(uint64_t s)
+{
+  return s & ((1u << room_bits) - 1);
+}
+
+static void world_name(unsigned move, char *buf, size_t size)
+{
+  unsigned k = w.num_keys;
+  if (move < 4)
+    snprintf(buf, size, "go %s", dir_names[move]);
+  else if (move < 4 + k)
+    snprintf(buf, size, "take key %u", move - 4);
+  else if (move == 4 + k)
+    snprintf(buf, size, "take light");
+  else if (move < 5 + 2 * k)
+    snprintf(buf, size, "use key %u", move - 5 - k);
+  else
+    snprintf(buf, size, "use light");
+}
+
+static void use_world(unsigned rooms, unsigned keys, unsigned seed)
+{
+  if (rooms < 2 || rooms > WORLD_MAX_ROOMS) {
+    fprintf(stderr, "explore: 2..%u rooms\n", WORLD_MAX_ROOMS);
+    exit(2);
+  }
+  w.num_rooms = rooms;
+  w.num_keys = keys;
+  w.exits = malloc(rooms * sizeof(*w.exits));
+  w.dark = malloc(WORLD_BITSET_WORDS(rooms) * 4);
+  w.locked = malloc(WORLD_BITSET_WORDS(rooms) * 4);
+  int16_t *scratch = malloc(2 * rooms * sizeof(int16_t));
+  world_generate(&w, scratch, seed);
+  free(scratch);
+
+  door_key = calloc(rooms, sizeof(*door_key));
+  for (unsigned i = 0; i < w.num_keys; i++)
+    door_key[w.key_door[i]] = i;
+
+  for (room_bits = 1; (1u << room_bits) < rooms; room_bits++)
+    ;
+  held_at = room_bits;
+  used_at = held_at + w.num_keys;
+  light_at = used_at + w.num_keys;
+  if (light_at + 2 > 63) {
+    fprintf(stderr, "explore: %u rooms and %u keys don't fit a 63-bit state\n", rooms, w.num_keys);
+    exit(2);
+  }
+
+  m.num_rooms = rooms;
+  m.num_moves = 2 * w.num_keys + 6;
+  m.start = w.start;
+  m.step = world_step;
+  m.won = world_won;
+  m.room = world_room;
+  m.name = world_name;
+}
+
+/* --------------------------------------------------------------- state set */
+
+/* Slots hold state + 1, so an all-zero (calloc'ed, untouched) slot is empty */
+static uint64_t *slot_key;
+static uint32_t *slot_id;
+static uint64_t slot_mask;
+
+static uint64_t *state_of;         /* by state number */
+static uint32_t *parent;
+static uint8_t *via;               /* the move from the parent */
+static uint32_t max_states = 1u << 22;
+static uint32_t num_states;
+static int full;
+static uint8_t *room_seen;
+
+static uint64_t hash(uint64_t x)
+{
+  x ^= x >> 31;
+  x *= 0x7fb5d329728ea185ull;
+  x ^= x >> 27;
+  x *= 0x81dadef4bc2dd44dull;
+  return x ^ (x >> 33);
+}
+
+/* Adds the state if it is new. Returns 1 if this call added it. */
+static int insert(uint64_t state, uint32_t from, unsigned move)
+{
+  uint64_t key = state + 1;
+  for (uint64_t i = hash(state) & slot_mask;; i = (i + 1) & slot_mask) {
+    uint64_t cur = __atomic_load_n(&slot_key[i], __ATOMIC_ACQUIRE);
+    if (cur == 0) {
+      uint64_t empty = 0;
+      if (!__atomic_compare_exchange_n(&slot_key[i], &empty, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        cur = empty;               /* somebody took the slot first */
+      } else {
+        uint32_t id = __atomic_fetch_add(&num_states, 1, __ATOMIC_RELAXED);
+        if (id >= max_states) {
+          __atomic_store_n(&full, 1, __ATOMIC_RELAXED);
+          return 0;
+        }
+        state_of[id] = state;
+        parent[id] = from;
+        via[id] = move;
+        slot_id[i] = id;
+        __atomic_store_n(&room_seen[m.room(state)], 1, __ATOMIC_RELAXED);
+        return 1;
+      }
+    }
+    if (cur == key)
+      return 0;
+  }
+}
+
+/* Number of a state that is in the set (only used once the search is over) */
+static uint32_t find(uint64_t state)
+{
+  uint64_t key = state + 1;
+  uint64_t i = hash(state) & slot_mask;
+  while (slot_key[i] != key)
+    i = (i + 1) & slot_mask;
+  return slot_id[i];
+}
+
+/* ----------------------------------------------------------------- search */
+
+#define CHUNK 256
+
+static unsigned num_threads;
+static pthread_barrier_t barrier;
+static uint32_t level_start, level_end, next_chunk;
+static unsigned levels;
+static int done;
+static unsigned long long transitions;   /* moves that change the state */
+
+/* Takes chunks of the current level until it is used up */
+static void expand_level(void)
+{
+  unsigned long long changes = 0;
+  uint32_t lo;
+
+  while ((lo = __atomic_fetch_add(&next_chunk, CHUNK, __ATOMIC_RELAXED)) < level_end) {
+    uint32_t hi = lo + CHUNK < level_end ? lo + CHUNK : level_end;
+    for (uint32_t id = lo; id < hi; id++) {
+      uint64_t s = state_of[id];
+      if (m.won(s))
+        continue;                  /* the game is over there */
+      for (unsigned move = 0; move < m.num_moves; move++) {
+        uint64_t t = m.step(s, move);
+        if (t != s) {
+          changes++;
+          insert(t, id, move);
+        }
+      }
+    }
+  }
+  __atomic_fetch_add(&transitions, changes, __ATOMIC_RELAXED);
+}
+
+static void *search_thread(void *arg)
+{
+  unsigned tid = (uintptr_t) arg;
+
+  for (;;) {
+    pthread_barrier_wait(&barrier);
+    if (done)
+      return NULL;
+    expand_level();
+    pthread_barrier_wait(&barrier);
+    if (tid == 0) {                /* set up the next level */
+      uint32_t n = num_states < max_states ? num_states : max_states;
+      levels++;
+      level_start = level_end;
+      level_end = n;
+      next_chunk = level_start;
+      done = level_start == level_end || full;
+    }
+  }
+}
+
+/* Dead ends: a second look at every transition stores it backwards (edges
+   into each state, counted first, then filled in), and a backward BFS from
+   the won states marks everything that can still win. */
+static uint32_t *pred_start;       /* edges into state i: pred[pred_start[i] .. pred_start[i + 1]) */
+static uint32_t *pred;
+static int filling;                /* 0: count the edges, 1: store them */
+
+static void *reverse_edges(void *arg)
+{
+  unsigned tid = (uintptr_t) arg;
+
+  for (uint32_t id = tid; id < num_states; id += num_threads) {
+    uint64_t s = state_of[id];
+    if (m.won(s))
+      continue;
+    for (unsigned move = 0; move < m.num_moves; move++) {
+      uint64_t t = m.step(s, move);
+      if (t == s)
+        continue;
+      uint32_t to = find(t);
+      if (filling)
+        pred[__atomic_fetch_add(&pred_start[to], 1, __ATOMIC_RELAXED)] = id;
+      else
+        __atomic_fetch_add(&pred_start[to + 1], 1, __ATOMIC_RELAXED);
+    }
+  }
+  return NULL;
+}
+
+static void run_threads(void *(*fn)(void *))
+{
+  pthread_t t[num_threads];
+  for (unsigned i = 1; i < num_threads; i++)
+    pthread_create(&t[i], NULL, fn, (void *) (uintptr_t) i);
+  fn((void *) 0);
+  for (unsigned i = 1; i < num_threads; i++)
+    pthread_join(t[i], NULL);
+}
+
+/* The moves from the start to a state, printed and optionally as a script */
+static void print_path(uint32_t id, FILE *script)
+{
+  unsigned n = 0;
+  for (uint32_t i = id; i != 0; i = parent[i])
+    n++;
+  uint32_t *path = malloc((n + 1) * sizeof(*path));
+  for (uint32_t i = id, k = n; i != 0; i = parent[i])
+    path[--k] = i;
+
+  for (unsigned k = 0; k < n; k++) {
+    char name[32];
+    m.name(via[path[k]], name, sizeof(name));
+    printf("  %3u. %s\n", k + 1, name);
+    if (script)
+      fprintf(script, "%s\n", name);
+  }
+  free(path);
+}
+
+static double seconds(const struct timespec *a, const struct timespec *b)
+{
+  return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  const char *script_name = NULL;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  num_threads = cpus > 0 ? cpus : 1;
+  use_game();
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      num_threads = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+      max_states = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      script_name = argv[++i];
+    else if (strcmp(argv[i], "-w") == 0 && i + 3 < argc) {
+      unsigned rooms = strtoul(argv[i + 1], NULL, 0), keys = strtoul(argv[i + 2], NULL, 0);
+      use_world(rooms, keys, strtoul(argv[i + 3], NULL, 0));
+      i += 3;
+    } else {
+      fprintf(stderr, "usage: %s [-j threads] [-m max_states] [-o script] [-w rooms keys seed]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (parser_check() != 0) {
+    fprintf(stderr, "%s: parser-words.h doesn't fit parser.c, run make parser-words\n", argv[0]);
+    return 1;
+  }
+  if (num_threads == 0)
+    num_threads = 1;
+  if (max_states == 0 || max_states > 1u << 31)
+    max_states = 1u << 31;
+
+  uint64_t slots = 1024;
+  while (slots < 2ull * max_states)
+    slots *= 2;
+  slot_mask = slots - 1;
+  slot_key = calloc(slots, sizeof(*slot_key));
+  slot_id = malloc(slots * sizeof(*slot_id));
+  state_of = malloc((size_t) max_states * sizeof(*state_of));
+  parent = malloc((size_t) max_states * sizeof(*parent));
+  via = malloc(max_states);
+  room_seen = calloc(m.num_rooms, 1);
+  if (!slot_key || !slot_id || !state_of || !parent || !via) {
+    fprintf(stderr, "explore: not enough memory for %u states\n", max_states);
+    return 1;
+  }
+
+  struct timespec t0, t1, t2;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  insert(m.start, 0, 0);
+  level_end = num_states;
+  pthread_barrier_init(&barrier, NULL, num_threads);
+  run_threads(search_thread);
+  if (num_states > max_states)
+    num_states = max_states;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  uint8_t *can_win = calloc(num_states, 1);
+  if (!full) {
+    pred_start = calloc(num_states + 1, sizeof(*pred_start));
+    pred = malloc(transitions * sizeof(*pred));
+    run_threads(reverse_edges);
+    for (uint32_t i = 0; i < num_states; i++)
+      pred_start[i + 1] += pred_start[i];
+    filling = 1;
+    run_threads(reverse_edges);    /* moves every pred_start[i] up to the start of i + 1 */
+    for (uint32_t i = num_states; i > 0; i--)
+      pred_start[i] = pred_start[i - 1];
+    pred_start[0] = 0;
+
+    uint32_t *queue = malloc(num_states * sizeof(*queue)), head = 0, tail = 0;
+    for (uint32_t id = 0; id < num_states; id++)
+      if (m.won(state_of[id])) {
+        can_win[id] = 1;
+        queue[tail++] = id;
+      }
+    while (head != tail) {
+      uint32_t id = queue[head++];
+      for (uint32_t e = pred_start[id]; e < pred_start[id + 1]; e++)
+        if (!can_win[pred[e]]) {
+          can_win[pred[e]] = 1;
+          queue[tail++] = pred[e];
+        }
+    }
+    free(queue);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  printf("%u rooms, %u moves per state, %u threads\n", m.num_rooms, m.num_moves, num_threads);
+  printf("%u states, %llu transitions, %u levels in %.3f s (%.0f states/s)%s\n",
+         num_states, transitions, levels, seconds(&t0, &t1),
+         num_states / (seconds(&t0, &t1) + 1e-9),
+         full ? ", STOPPED: state limit reached, raise -m" : "");
+
+  uint32_t win = 0;
+  while (win < num_states && !m.won(state_of[win]))
+    win++;
+  if (win == num_states) {
+    printf("\nThe game can't be won.\n");
+  } else {
+    unsigned n = 0;
+    for (uint32_t i = win; i != 0; i = parent[i])
+      n++;
+    printf("\nShortest win, %u commands:\n", n);
+    FILE *script = script_name ? fopen(script_name, "w") : NULL;
+    if (script_name && !script)
+      perror(script_name);
+    if (script)
+      fprintf(script, "# shortest win found by host/explore\n");
+    print_path(win, script);
+    if (script)
+      fclose(script);
+  }
+
+  unsigned unseen = 0;
+  for (unsigned r = 0; r < m.num_rooms; r++)
+    unseen += !room_seen[r];
+  printf("\nUnreachable rooms: %u", unseen);
+  for (unsigned r = 0, shown = 0; r < m.num_rooms && shown < 20; r++) {
+    if (room_seen[r])
+      continue;
+    if (m.room_name)
+      printf("%s%s", shown ? ", " : " (", m.room_name(r));
+    else
+      printf("%s%u", shown ? ", " : " (", r);
+    shown++;
+  }
+  printf("%s\n", unseen ? (unseen > 20 ? ", ...)" : ")") : "");
+
+  if (full) {
+    printf("Dead ends: not checked, the search is incomplete\n");
+    return 1;
+  }
+  uint32_t dead = 0, first_dead = num_states;
+  for (uint32_t id = 0; id < num_states; id++) {
+    if (!can_win[id]) {
+      dead++;
+      if (first_dead == num_states)
+        first_dead = id;
+    }
+  }
+  printf("Dead ends: %u states from which the game can't be won (%.3f s)\n",
+         dead, seconds(&t1, &t2));
+  if (dead != 0) {
+    printf("The nearest one:\n");
+    print_path(first_dead, NULL);
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+/* game-host.c - runs game.c natively from an input script, for profiling
+   (perf) and for checking that a change doesn't alter the game's output.
+
+   usage: game-host [-q] [-n runs] script
+
+   Script lines:
+     sw <hex>      set SW9..SW0
+     btn           press the button: run the command on the switches
+     press <hex>   sw + btn in one line
+     # ...         comment, empty lines are skipped
+   anything else is a typed command, echoed like the board's terminal does.
+
+   Each run starts a new game and plays the script until it ends or the game
+   is won. The transcript goes to stdout (not with -q), the summary with the
+   hash of the whole transcript to stderr. It refuses to run when
+   parser_check finds parser-words.h out of date. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../game.h"
+#include "../parser.h"
+#include "../hal.h"
+#include "../dtekv-lib.h"
+#include "host.h"
+
+enum event_type { EV_SW, EV_PRESS, EV_TEXT };
+
+struct event {
+  enum event_type type;
+  unsigned sw;
+  const char *text;
+  unsigned len;
+};
+
+static struct event *events;
+static unsigned num_events;
+
+/* Splits the script into events once, so a run only executes them */
+static void load_script(char *s)
+{
+  unsigned cap = 64;
+  events = malloc(cap * sizeof(*events));
+
+  for (char *line = strtok(s, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")) {
+    while (*line == ' ' || *line == '\t')
+      line++;
+    if (*line == '\0' || *line == '#')
+      continue;
+    if (num_events + 2 > cap) {
+      cap *= 2;
+      events = realloc(events, cap * sizeof(*events));
+    }
+    struct event *e = &events[num_events++];
+    if (strncmp(line, "sw ", 3) == 0) {
+      e->type = EV_SW;
+      e->sw = strtoul(line + 3, NULL, 16);
+    } else if (strcmp(line, "btn") == 0) {
+      e->type = EV_PRESS;
+    } else if (strncmp(line, "press ", 6) == 0) {
+      e->type = EV_SW;
+      e->sw = strtoul(line + 6, NULL, 16);
+      events[num_events++].type = EV_PRESS;
+    } else {
+      e->type = EV_TEXT;
+      e->text = line;
+      e->len = strlen(line);
+    }
+  }
+}
+
+/* One game. Returns the number of commands run. */
+static unsigned run_script(int *won)
+{
+  unsigned commands = 0;
+
+  game_init();
+  game_begin();
+  print_lit("> ");
+  *won = 0;
+  for (unsigned i = 0; i < num_events; i++) {
+    const struct event *e = &events[i];
+    switch (e->type) {
+    case EV_SW:
+      host_set_sw(e->sw);
+      continue;
+    case EV_PRESS:
+      run_switch_command(hal_get_sw());
+      break;
+    case EV_TEXT:
+      print_n(e->text, e->len);
+      printc('\n');
+      run_text_command(e->text, e->len);
+      break;
+    }
+    commands++;
+    if (check_end()) {
+      *won = 1;
+      break;
+    }
+  }
+  return commands;
+}
+
+static char *read_file(const char *name)
+{
+  FILE *f = fopen(name, "rb");
+  if (f == NULL) {
+    perror(name);
+    exit(1);
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *s = malloc(size + 1);
+  if (fread(s, 1, size, f) != (size_t) size) {
+    perror(name);
+    exit(1);
+  }
+  s[size] = '\0';
+  fclose(f);
+  return s;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long runs = 1;
+  const char *script = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0)
+      host_echo = 0;
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      runs = strtoul(argv[++i], NULL, 0);
+    else
+      script = argv[i];
+  }
+  if (script == NULL) {
+    fprintf(stderr, "usage: %s [-q] [-n runs] script\n", argv[0]);
+    return 2;
+  }
+  if (parser_check() != 0) {
+    fprintf(stderr, "%s: parser-words.h doesn't fit parser.c, run make parser-words\n", argv[0]);
+    return 1;
+  }
+  load_script(read_file(script));
+
+  unsigned long long commands = 0;
+  unsigned long wins = 0;
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (unsigned long r = 0; r < runs; r++) {
+    int won;
+    commands += run_script(&won);
+    wins += won;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  unsigned long long bytes = host_out_bytes();
+  fprintf(stderr, "%lu runs, %lu won, %llu commands in %.3f s: %.0f commands/s\n",
+          runs, wins, commands, secs, secs > 0 ? commands / secs : 0.0);
+  fprintf(stderr, "output %llu bytes, hash %08x, LEDs %03x\n",
+          bytes, (unsigned) host_out_hash(), host_leds());
+  return 0;
+}
@@ -0,0 +1,60 @@
+/* hal-host.c - hal.h on the host: the LEDs are a word in memory, the
+   switches are whatever the input script set last. */
+#include "../hal.h"
+#include "../dtekv-lib.h"
+#include "../idle.h"
+#include "../sched.h"
+#include "../save.h"
+#include "host.h"
+
+static unsigned leds;
+static unsigned switches;
+
+void hal_set_leds(unsigned mask)
+{
+  leds = mask & 0x3ff;
+}
+
+unsigned hal_get_sw(void)
+{
+  return switches;
+}
+
+/* Presses are delivered as whole events by the script runner */
+unsigned hal_get_btn(void)
+{
+  return 0;
+}
+
+void host_set_sw(unsigned sw)
+{
+  switches = sw & 0x3ff;
+}
+
+unsigned host_leds(void)
+{
+  return leds;
+}
+
+/* idle.c measures wfi sleep, there is none on the host */
+void idle_report(void)
+{
+  print("No load numbers on the host.\n");
+}
+
+/* game-host runs the commands itself, there is no scheduler (sched.c) */
+void sched_report(void)
+{
+}
+
+/* No saved game (save.c) and no reset on the host, every run is a new game.
+   save_dump is weak, so host/save-test.c can link the real save.c. */
+__attribute__((weak)) void save_dump(void)
+{
+  print("No saved game on the host.\n");
+}
+
+void soft_reset(void)
+{
+  print("No reset on the host.\n");
+}
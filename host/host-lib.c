@@ -0,0 +1,110 @@
+/* host-lib.c - the parts of dtekv-lib.c that host builds (-DHAL_HOST) need.
+   Text goes into a memory buffer instead of the JTAG UART. Whenever the
+   buffer fills up (and at exit) it is folded into a running FNV-1a hash,
+   so a whole run can be compared by one number, and written to stdout
+   unless host_echo is 0. mcycle is replaced by clock_gettime. */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../dtekv-lib.h"
+#include "host.h"
+
+#define HOST_OUT_SIZE (1 << 16)
+
+int host_echo = 1;
+
+static char out_buf[HOST_OUT_SIZE];
+static unsigned out_len;
+static uint32_t out_hash = 2166136261u;
+static unsigned long long out_bytes;
+
+void host_out_flush(void)
+{
+  for (unsigned i = 0; i < out_len; i++)
+    out_hash = (out_hash ^ (unsigned char) out_buf[i]) * 16777619u;
+  out_bytes += out_len;
+  if (host_echo)
+    fwrite(out_buf, 1, out_len, stdout);
+  out_len = 0;
+}
+
+__attribute__((destructor)) static void flush_at_exit(void)
+{
+  host_out_flush();
+  fflush(stdout);
+}
+
+uint32_t host_out_hash(void)
+{
+  host_out_flush();
+  return out_hash;
+}
+
+unsigned long long host_out_bytes(void)
+{
+  host_out_flush();
+  return out_bytes;
+}
+
+void printc(char c)
+{
+  if (out_len == HOST_OUT_SIZE)
+    host_out_flush();
+  out_buf[out_len++] = c;
+}
+
+void print_n(const char *s, unsigned len)
+{
+  while (len != 0) {
+    unsigned n = HOST_OUT_SIZE - out_len;
+    if (n == 0) {
+      host_out_flush();
+      continue;
+    }
+    if (n > len) n = len;
+    memcpy(out_buf + out_len, s, n);
+    out_len += n;
+    s += n;
+    len -= n;
+  }
+}
+
+void print(char *s)
+{
+  print_n(s, strlen(s));
+}
+
+void print_dec(unsigned int x)
+{
+  char buf[16];
+  print_n(buf, snprintf(buf, sizeof(buf), "%u", x));
+}
+
+void print_dec_pad(unsigned int x, unsigned width, char pad)
+{
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%*u", (int) (width < 16 ? width : 16), x);
+  for (int i = 0; i < n && buf[i] == ' '; i++)
+    buf[i] = pad;
+  print_n(buf, n);
+}
+
+void print_hex32(unsigned int x)
+{
+  char buf[16];
+  print_n(buf, snprintf(buf, sizeof(buf), "0x%08X", x));
+}
+
+/* No receiver on the host, typed lines come from the script */
+int uart_getc(void)
+{
+  return -1;
+}
+
+/* Nanoseconds, wrapping like mcycle does (every 4.3 s instead of 143 s) */
+unsigned read_mcycle(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned) t.tv_sec * 1000000000u + (unsigned) t.tv_nsec;
+}
@@ -0,0 +1,18 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+
+/* Host backends (-DHAL_HOST): what the board does with MMIO, done in memory */
+
+/* host-lib.c: the print functions collect text in a memory buffer */
+extern int host_echo;                  /* also write the text to stdout (default) */
+void host_out_flush(void);
+uint32_t host_out_hash(void);          /* FNV-1a of everything printed so far */
+unsigned long long host_out_bytes(void);
+
+/* hal-host.c: LEDs and switches */
+void host_set_sw(unsigned sw);
+unsigned host_leds(void);
+
+#endif
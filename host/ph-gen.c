@@ -0,0 +1,148 @@
+/* ph-gen.c - generates parser-words.h, the perfect hash table of the
+   parser's vocabulary (parser.c).
+
+   usage: ph-gen > parser-words.h      ("make parser-words" does this)
+
+   Every word is hashed like parse_command does: 32-bit FNV-1a over the
+   letters folded to lower case with | 0x20. The seed is the smallest one
+   for which PH_SLOT puts all words into different slots, so a lookup never
+   needs a string compare. To change the vocabulary, edit vocabulary[] below
+   and run "make parser-words"; parser_check (game-host, explore and make
+   bench run it) catches a table that no longer fits parser.c. */
+#include <stdio.h>
+#include <string.h>
+
+/* Must match parser.c */
+#define FNV_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+#define PH_BITS 6
+#define PH_SIZE (1 << PH_BITS)
+#define PH_SLOT(h, seed) ((((h) ^ (seed)) * 0x9E3779B1u) >> (32 - PH_BITS))
+
+struct entry {
+  const char *text;
+  const char *kind;    /* enum word_kind in parser.c */
+  const char *value;   /* C expression, written as it is */
+};
+
+static const struct entry vocabulary[] = {
+  /* verbs */
+  { "go",         "WORD_VERB",   "CMD_GO" },
+  { "walk",       "WORD_VERB",   "CMD_GO" },
+  { "take",       "WORD_VERB",   "CMD_TAKE" },
+  { "get",        "WORD_VERB",   "CMD_TAKE" },
+  { "grab",       "WORD_VERB",   "CMD_TAKE" },
+  { "use",        "WORD_VERB",   "CMD_USE" },
+  { "travel",     "WORD_VERB",   "VERB_TRAVEL" },
+  { "goto",       "WORD_VERB",   "VERB_TRAVEL" },
+  /* directions, 0 north .. 3 west */
+  { "north",      "WORD_DIR",    "0" },
+  { "n",          "WORD_DIR",    "0" },
+  { "south",      "WORD_DIR",    "1" },
+  { "s",          "WORD_DIR",    "1" },
+  { "east",       "WORD_DIR",    "2" },
+  { "e",          "WORD_DIR",    "2" },
+  { "west",       "WORD_DIR",    "3" },
+  { "w",          "WORD_DIR",    "3" },
+  /* items, ids of game.c items[] */
+  { "flashlight", "WORD_ITEM",   "0" },
+  { "light",      "WORD_ITEM",   "0" },
+  { "torch",      "WORD_ITEM",   "0" },
+  { "silver",     "WORD_ITEM",   "1" },
+  { "brass",      "WORD_ITEM",   "2" },
+  /* CMD_OTHER commands: 0 look, 1 inventory, 2 load, 3 profile */
+  { "look",       "WORD_ACTION", "0" },
+  { "l",          "WORD_ACTION", "0" },
+  { "inventory",  "WORD_ACTION", "1" },
+  { "inv",        "WORD_ACTION", "1" },
+  { "i",          "WORD_ACTION", "1" },
+  { "load",       "WORD_ACTION", "2" },
+  { "profile",    "WORD_ACTION", "3" },
+  /* commands on their own */
+  { "save",       "WORD_SYSTEM", "CMD_SAVE" },
+  { "reset",      "WORD_SYSTEM", "CMD_RESET" },
+  /* noise */
+  { "the",        "WORD_NOISE",  "0" },
+  { "a",          "WORD_NOISE",  "0" },
+  { "at",         "WORD_NOISE",  "0" },
+  { "up",         "WORD_NOISE",  "0" },
+  { "on",         "WORD_NOISE",  "0" },
+  { "off",        "WORD_NOISE",  "0" },
+  { "key",        "WORD_NOISE",  "0" },
+  { "to",         "WORD_NOISE",  "0" },
+  { "room",       "WORD_NOISE",  "0" },
+};
+
+#define NUM_WORDS (sizeof(vocabulary) / sizeof(vocabulary[0]))
+
+static unsigned hash(const char *t)
+{
+  unsigned h = FNV_BASIS;
+  while (*t != '\0')
+    h = (h ^ (unsigned char) (*t++ | 0x20)) * FNV_PRIME;
+  return h;
+}
+
+int main(void)
+{
+  unsigned h[NUM_WORDS];
+  int slot[PH_SIZE];
+  unsigned seed = 0;
+
+  if (NUM_WORDS > PH_SIZE) {
+    fprintf(stderr, "ph-gen: %u words don't fit %u slots, raise PH_BITS\n",
+            (unsigned) NUM_WORDS, PH_SIZE);
+    return 1;
+  }
+  for (unsigned i = 0; i < NUM_WORDS; i++) {
+    h[i] = hash(vocabulary[i].text);
+    for (unsigned j = 0; j < i; j++) {
+      if (h[j] == h[i]) {
+        fprintf(stderr, "ph-gen: \"%s\" and \"%s\" have the same hash\n",
+                vocabulary[j].text, vocabulary[i].text);
+        return 1;
+      }
+    }
+  }
+
+  for (;;) {
+    unsigned i;
+    memset(slot, -1, sizeof(slot));
+    for (i = 0; i < NUM_WORDS; i++) {
+      unsigned s = PH_SLOT(h[i], seed);
+      if (slot[s] >= 0)
+        break;
+      slot[s] = i;
+    }
+    if (i == NUM_WORDS)
+      break;
+    if (++seed == 0) {
+      fprintf(stderr, "ph-gen: no seed works, raise PH_BITS\n");
+      return 1;
+    }
+  }
+
+  printf("/* parser-words.h - the vocabulary of parser.c as a perfect hash table.\n"
+         "   Generated by host/ph-gen.c (make parser-words), don't edit: change\n"
+         "   the word list there and regenerate. */\n"
+         "#if PH_BITS != %d\n"
+         "#error \"parser-words.h was generated for another PH_BITS, run make parser-words\"\n"
+         "#endif\n"
+         "\n"
+         "#define PH_SEED 0x%xu   /* smallest seed that gives every word its own slot */\n"
+         "\n"
+         "static const struct word words[PH_SIZE] = {\n", PH_BITS, seed);
+  for (unsigned s = 0; s < PH_SIZE; s++) {
+    char kind[16], value[16];
+    const struct entry *e;
+    if (slot[s] < 0)
+      continue;
+    e = &vocabulary[slot[s]];
+    snprintf(kind, sizeof(kind), "%s,", e->kind);
+    snprintf(value, sizeof(value), "%s,", e->value);
+    printf("  [%2u] = { 0x%08xu, %-12s %-12s \"%s\" },\n", s, h[slot[s]], kind, value, e->text);
+  }
+  printf("};\n");
+  return 0;
+}
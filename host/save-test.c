@@ -0,0 +1,81 @@
+/* save-test.c - feeds saved games to save_restore (save.c) and checks which
+   ones come back. Every record has a good magic, version and CRC, so only
+   game_restore decides: states play can reach must be restored, broken
+   ones (a key used that was never carried, the light on without a light,
+   a door open without its key...) must be refused and leave the running
+   game alone.
+
+   usage: save-test          ("make save-test-run" builds and runs it)
+   Prints one line per case and exits with 1 if any case fails. */
+#include <stdio.h>
+#include <string.h>
+#include "../game.h"
+#include "host.h"
+
+/* The slots and the CRC are static in save.c, the test writes the slots
+   itself */
+#include "../save.c"
+
+/* Mystery House: items 0 flashlight, 1 silver key (Storage Room 7), 2 brass
+   key (Exit Door 8); flags bit 0 is the light */
+#define FLASHLIGHT (1u << 0)
+#define SILVER_KEY (1u << 1)
+#define BRASS_KEY  (1u << 2)
+#define LIGHT_ON   0x1
+#define LOCKED     ((1u << 7) | (1u << 8))
+
+struct test_case {
+  const char *what;
+  unsigned state[GAME_SAVE_WORDS];   /* room, inventory, keys used, flags, locked, moves */
+  int restored;
+};
+
+static const struct test_case cases[] = {
+  { "new game",                          { 0, 0, 0, 0, LOCKED, 0 }, 1 },
+  { "light on, Storage Room open",       { 6, FLASHLIGHT | SILVER_KEY, SILVER_KEY, LIGHT_ON, 1u << 8, 9 }, 1 },
+  { "both doors open",                   { 8, FLASHLIGHT | SILVER_KEY | BRASS_KEY, SILVER_KEY | BRASS_KEY, 0, 0, 17 }, 1 },
+  { "key used but never carried",        { 6, FLASHLIGHT, SILVER_KEY, 0, 1u << 8, 9 }, 0 },
+  { "flashlight used as a key",          { 1, FLASHLIGHT, FLASHLIGHT, 0, LOCKED, 3 }, 0 },
+  { "light on without the flashlight",   { 3, 0, 0, LIGHT_ON, LOCKED, 4 }, 0 },
+  { "flag bit the game never sets",      { 0, 0, 0, 0x80, LOCKED, 0 }, 0 },
+  { "door open without its key",         { 7, FLASHLIGHT, 0, 0, 1u << 8, 5 }, 0 },
+  { "key used, door still locked",       { 6, SILVER_KEY, SILVER_KEY, 0, LOCKED, 7 }, 0 },
+  { "item that doesn't exist",           { 0, 1u << 3, 0, 0, LOCKED, 0 }, 0 },
+  { "room that doesn't exist",           { 9, 0, 0, 0, LOCKED, 0 }, 0 },
+};
+
+/* One good record in slot 0, slot 1 empty */
+static void put_record(const unsigned state[GAME_SAVE_WORDS])
+{
+  struct save_record *r = &slots[0];
+  r->magic = SAVE_MAGIC;
+  r->version = SAVE_VERSION;
+  r->size = sizeof(struct save_record);
+  r->seq = 1;
+  memcpy(r->state, state, sizeof(r->state));
+  r->crc = crc32((const unsigned *) r, SAVE_CRC_WORDS);
+  slots[1].magic = 0;
+}
+
+int main(void)
+{
+  unsigned before[GAME_SAVE_WORDS], after[GAME_SAVE_WORDS];
+  int failed = 0;
+
+  host_echo = 0;
+  for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    const struct test_case *c = &cases[i];
+    game_init();
+    game_save(before);
+    put_record(c->state);
+    int restored = save_restore();
+    game_save(after);
+
+    int ok = restored == c->restored &&
+             memcmp(after, restored ? c->state : before, sizeof(after)) == 0;
+    printf("%-4s %-36s %s\n", ok ? "ok" : "FAIL", c->what, restored ? "restored" : "refused");
+    failed += !ok;
+  }
+  printf("%d of %u failed\n", failed, (unsigned) (sizeof(cases) / sizeof(cases[0])));
+  return failed != 0;
+}
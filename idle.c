@@ -0,0 +1,58 @@
+#include "idle.h"
+#include "dtekv-lib.h"
+#include "timer.h"
+
+/* Cycle accounting. Everything between two wfi wake-ups that is not spent
+   inside wfi is busy time. Numbers are latched once per second of mcycle
+   so idle_report always shows a complete one-second window. */
+static unsigned window_start;      /* mcycle at the start of the current window */
+static unsigned window_idle;       /* idle cycles so far in the current window */
+static unsigned last_total;        /* length of the last complete window */
+static unsigned last_idle;         /* idle cycles in the last complete window */
+
+static void roll_window(unsigned now)
+{
+  if (now - window_start >= TIMER_CLOCK_HZ) {
+    last_total = now - window_start;
+    last_idle = window_idle;
+    window_start = now;
+    window_idle = 0;
+  }
+}
+
+/* function: idle_wait
+   Description: Puts the CPU to sleep until an interrupt has produced work.
+   ready() is checked with interrupts off, so an event that arrives between
+   the check and wfi still wakes us: wfi returns on any pending enabled
+   interrupt even while mstatus.MIE is clear. The interrupt itself is taken
+   once MIE is set again. */
+void idle_wait(int (*ready)(void))
+{
+  unsigned status = irq_save();
+  if (!ready()) {
+    unsigned t0 = read_mcycle();
+    asm volatile ("wfi");
+    unsigned t1 = read_mcycle();
+    window_idle += t1 - t0;
+    roll_window(t1);
+  }
+  irq_restore(status);
+}
+
+/* function: idle_report
+   Description: Prints idle and busy cycles of the last complete second. */
+void idle_report(void)
+{
+  roll_window(read_mcycle());
+  if (last_total == 0) {
+    print("No load numbers yet, try again in a second.\n");
+    return;
+  }
+  print("Last second: busy ");
+  print_dec(last_total - last_idle);
+  print(" cycles, idle ");
+  print_dec(last_idle);
+  print(" cycles (");
+  print_dec(last_idle / (last_total / 100));
+  print("% idle)\n");
+}
@@ -0,0 +1,8 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+/* Sleep with wfi until ready() says there is work, counting idle cycles */
+void idle_wait(int (*ready)(void));
+void idle_report(void);
+
+#endif
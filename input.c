@@ -0,0 +1,103 @@
+#include "input.h"
+#include "timer.h"
+#include "hal.h"
+
+/* Event queue between the timer interrupt (the only producer) and the main
+   loop (the only consumer). Each side writes only its own index, so no
+   locking is needed. The size must be a power of two. */
+#define INPUT_QUEUE_SIZE 16
+
+static struct input_event queue[INPUT_QUEUE_SIZE];
+static volatile unsigned q_head;   /* written by input_sample */
+static volatile unsigned q_tail;   /* written by input_get */
+static unsigned dropped;
+
+/* One debouncer per input word: a new level is accepted once it has been
+   read INPUT_STABLE samples in a row, so contact bounce never reaches the game. */
+struct debounce {
+  unsigned stable;                 /* last accepted level */
+  unsigned candidate;              /* level we are currently counting */
+  unsigned count;
+};
+
+static struct debounce btn, sw;
+
+static int debounce(struct debounce *d, unsigned raw)
+{
+  if (raw != d->candidate) {
+    d->candidate = raw;
+    d->count = 0;
+    return 0;
+  }
+  if (d->count < INPUT_STABLE && ++d->count == INPUT_STABLE && raw != d->stable) {
+    d->stable = raw;
+    return 1;
+  }
+  return 0;
+}
+
+static void push(unsigned now, unsigned edge)
+{
+  unsigned head = q_head;
+  if (head - q_tail == INPUT_QUEUE_SIZE) {
+    dropped++;
+    return;
+  }
+  struct input_event *ev = &queue[head & (INPUT_QUEUE_SIZE - 1)];
+  ev->time = now;
+  ev->sw = sw.stable;
+  ev->edge = edge;
+  asm volatile ("" ::: "memory");   /* event fully written before it is published */
+  q_head = head + 1;
+}
+
+/* The timer interrupt, every INPUT_SAMPLE_US */
+static void input_timer_isr(unsigned cause)
+{
+  (void) cause;
+  input_sample(timer_isr());
+}
+
+/* function: input_init
+   Description: Takes the current levels as the starting point (so a button
+   held at boot is not a press) and starts sampling. */
+void input_init(void)
+{
+  btn.stable = btn.candidate = hal_get_btn();
+  sw.stable = sw.candidate = hal_get_sw();
+  timer_init(INPUT_SAMPLE_US, input_timer_isr);
+}
+
+/* function: input_sample
+   Description: Called from the timer interrupt. Reads BUTTONS and SWITCHES,
+   debounces them and queues an event for every accepted change. */
+void input_sample(unsigned now)
+{
+  if (debounce(&sw, hal_get_sw()))
+    push(now, INPUT_SWITCH);
+  if (debounce(&btn, hal_get_btn()))
+    push(now, btn.stable ? INPUT_PRESS : INPUT_RELEASE);
+}
+
+/* function: input_get
+   Description: Takes the oldest event off the queue. Returns 0 if there is none. */
+int input_get(struct input_event *ev)
+{
+  unsigned tail = q_tail;
+  if (tail == q_head)
+    return 0;
+  *ev = queue[tail & (INPUT_QUEUE_SIZE - 1)];
+  asm volatile ("" ::: "memory");   /* copy out before the slot is handed back */
+  q_tail = tail + 1;
+  return 1;
+}
+
+int input_pending(void)
+{
+  return q_tail != q_head;
+}
+
+unsigned input_dropped(void)
+{
+  return dropped;
+}
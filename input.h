@@ -0,0 +1,25 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+/* Debounced button/switch input, sampled from the timer interrupt */
+#define INPUT_SAMPLE_US 1000   /* timer period, command latency is bounded by this */
+#define INPUT_STABLE    8      /* samples a level must hold before we believe it */
+
+/* bits in input_event.edge */
+#define INPUT_PRESS   0x1      /* button went down */
+#define INPUT_RELEASE 0x2      /* button went up */
+#define INPUT_SWITCH  0x4      /* switch pattern changed */
+
+struct input_event {
+  unsigned time;               /* timer tick of the edge */
+  unsigned short sw;           /* debounced SW9..SW0 at that moment */
+  unsigned char edge;
+};
+
+void input_init(void);
+void input_sample(unsigned now);
+int input_get(struct input_event *ev);
+int input_pending(void);
+unsigned input_dropped(void);
+
+#endif
@@ -0,0 +1,23 @@
+#include "irq.h"
+
+/* An interrupt nobody registered: turn the source off, or it would trap again
+   right after the mret. */
+static void irq_unhandled(unsigned cause)
+{
+  irq_disable(cause);
+}
+
+/* boot.S calls irq_handlers[cause](cause) */
+irq_handler irq_handlers[IRQ_SOURCES] = { [0 ... IRQ_SOURCES - 1] = irq_unhandled };
+
+/* function: irq_register
+   Description: Installs handler for interrupt cause, enables that source in
+   mie and turns interrupts on (mstatus.MIE). */
+void irq_register(unsigned cause, irq_handler handler)
+{
+  if (cause >= IRQ_SOURCES)
+    return;
+  irq_handlers[cause] = handler;
+  irq_enable(cause);
+  asm volatile ("csrsi mstatus, 8");
+}
@@ -0,0 +1,32 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+/* Interrupt dispatch. boot.S runs mtvec in vectored mode: interrupt N jumps
+   to its own slot of the vector table and from there to irq_handlers[N],
+   nothing compares mcause on the way. Drivers register their handler at run
+   time instead of sharing one handle_interrupt. */
+
+/* mcause numbers of the DTEK-V interrupt sources (TIMER_IRQ is in timer.h,
+   JTAG_UART_IRQ in dtekv-lib.h) */
+#define SWITCH_IRQ  17
+#define BUTTON_IRQ  18
+
+#define IRQ_SOURCES 32
+
+typedef void (*irq_handler)(unsigned cause);
+extern irq_handler irq_handlers[IRQ_SOURCES];
+
+void irq_register(unsigned cause, irq_handler handler);
+
+/* One source on or off in mie, the others are left alone */
+static inline void irq_enable(unsigned cause)
+{
+  asm volatile ("csrs mie, %0" :: "r"(1u << cause) : "memory");
+}
+
+static inline void irq_disable(unsigned cause)
+{
+  asm volatile ("csrc mie, %0" :: "r"(1u << cause) : "memory");
+}
+
+#endif
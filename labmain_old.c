@@ -15,16 +15,15 @@
 
 #include <stdint.h>   // (a)(b)
 #include <stdbool.h>  // (a)(b)
+#include "clock.h"    // show_time_on_displays (h)
 
 
 /* ---------------------- Memory-mapped I/O ------------------------- */
 #define LEDS_ADDR      0x04000000u  // 10 LEDs base address (c)
 #define SWITCHES_ADDR  0x04000010u  // 10 toggle switches base address (f)
-#define DISP_BASE      0x04000050u // first 7-segment display base adress (e)
-#define DISP_STRIDE    0x10u      // each next display is +0x10 (e)
 #define BUTTON_ADDR    0x040000d0u   // push-button #2 adress (g)
 
-//Displays are in a contiguous block: display N is at DISP_BASE + N*DISP_STRIDE.
+//The 7-segment displays (e) are in seg7.c now and the HH:MM:SS view (h) in clock.c, the game's scheduler runs the same clock.
 
 #define LEDS     ((volatile unsigned int*) LEDS_ADDR) // volatile tells the compiler: this can change outside the program,-> (Volatile MMIO pointer to LEDs (c))
 #define SWITCHES ((volatile unsigned int*) SWITCHES_ADDR) //-> writing/reading through these pointers actually talks to the hardware. (Volatile MMIO pointer to switches (f))
@@ -38,20 +37,21 @@ extern void print_dec(unsigned int);      //UART print unsigned integer in decim
 extern void display_string(char*);        //ASCII time output (terminal/console) (a)(b)
 extern void time2string(char*, int);      // convert mytime to string (a)(b)
 extern void tick(int*);                   // increment mytime by one “second” (a)(b)
-extern void delay(int);                   // approximate 1s delay scaling (a)(b)
+extern void delay(int);                   // delay in ms (timetemplate.S -> delay_ms) (a)(b)
+extern void timing_calibrate(void);       // measure CPU cycles per ms against the board timer (timer.c)
+extern unsigned now_us(void);             // monotonic microseconds from mcycle (timer.c)
+extern void delay_ms(unsigned);           // calibrated busy-wait (timer.c)
 extern int  nextprime(int);               // not used in A1
+extern void syscall_report(void);         // ecall vs direct call cost, dtekv-lib.c
 
 
 /* ----------------------  globals ------------------ */
 int mytime = 0x0000;// is used by time2string and tick to show a text clock, initial time HHMM (a)(b)
-char textstring[] = "text, more text, and even more text!"; // UART buffer (a)(b
+char textstring[] __attribute__((aligned(4))) = "text, more text, and even more text!"; // UART buffer, word aligned so time2string can use word stores (a)(b
 
 
 /* ---------------------- A3 placeholder (empty in A1) -------------- */
-void handle_interrupt(unsigned cause)
-{
-  /* Not used in Assignment 1 */
-}
+/* Interrupt handlers get registered with irq_register (irq.c), none in Assignment 1 */
 
 
 
@@ -66,51 +66,6 @@ void set_leds(int led_mask) {//write the Led register, each bit turns one LED on
 
 
 
-   //(e) write raw values to a 7-segement display (active-low segments)
-   
-void set_displays(int display_number, int value) { // (e)
-  if (display_number < 0 || display_number > 5) //display_number 0-5 selects which of the six 7-seg displays (e)
-     return;
-     //we compute it's adress:base+ index *stride (0x10) (e)
-  volatile unsigned int* disp = (volatile unsigned int*)(DISP_BASE + (unsigned)display_number * DISP_STRIDE);
-  *disp = (unsigned int)value; // we write value directly. On this board, writing 0 lights a segement (active-low) (e)
-  //this is a low level and  expects a segment pattern not a digit (e)
-  //What is value: 
-  //It's an 8-bit pattern that tells the hardware which segments to light.
-  //What does active-low mean?:
-  //that an 0 bit means "turn this segment ON" and a 1 bit means "turn this segment OFF"
-}
-
-
-/* Helper: map 0–9 to active-low 7-seg patterns (bit0=a..bit6=g, bit7=dp).
-   Writing 0 lights a segment. These are standard common-anode patterns. */
-   //digit--> segment lookup table (active-low) (e)
-   //handy table: index 0-9 gives you the 7-seg pattern for that digit, dp =decimal point. 0 turns a segment ON
-static const unsigned char SEG_DIGIT[10] = {
-  0xC0, /* 0 */
-  0xF9, /* 1 */
-  0xA4, /* 2 */
-  0xB0, /* 3 */
-  0x99, /* 4 */
-  0x92, /* 5 */
-  0x82, /* 6 */
-  0xF8, /* 7 */
-  0x80, /* 8 */
-  0x90  /* 9 */
-};
-
-
-// helper to write a single digit to a display
-// validates inputs the calls set_displays with the correct segment value
-static void set_display_digit(int display_number, int digit) { // (e)
-  if (display_number < 0 || display_number > 5) return; // guard index (e)
-  if (digit < 0 || digit > 9) return;                   // guard digit (e)
-  set_displays(display_number, SEG_DIGIT[digit]);       // map digit to segments (e)
-}
-
-
-
-
    //(f) read the 10 toggle switches (SW0..SW9)
    // reads the switch register and keeps the lowest 10 bits (sw0..Sw9)
    
@@ -137,7 +92,7 @@ static void start_sequence(void) { //(d)
   set_leds(0); // clears leds, start at 0000 on LEDs (d)
   for (unsigned i = 0; i < 16; ++i) { // counts from 0-15 on the first 4 leds (d)
     set_leds(i & 0xF);  //show 0000..1111 on LEDs 0–3 (d)
-    delay(2);           // each step waits " about a second" (scale from Lab1) (d)
+    delay_ms(1000);     // each step waits one second (calibrated, see timer.c) (d)
   }
 
 
@@ -151,7 +106,7 @@ static void start_sequence(void) { //(d)
 
 
 /*
-   (h) show HH:MM:SS on displays, button+switch to set fields
+   (h) HH:MM:SS on the displays (clock.c), button+switch to set fields
    - Displays 0..5 are assumed left..right:
        [0][1] hours, [2][3] minutes, [4][5] seconds
    - Field select via SW9..SW8:
@@ -160,28 +115,15 @@ static void start_sequence(void) { //(d)
    - Value via SW5..SW0 (0..63)
    - Use SW7 to exit the program (one of the “remaining switches”).
     */
-static void show_time_on_displays(int hours, int minutes, int seconds) { // (h)
-  /* Rightmost pair (HEX0, HEX1) = seconds */
-  set_display_digit(1, (seconds / 10) % 10);  // HEX1 = tens of seconds (h)
-  set_display_digit(0,  seconds % 10);        // HEX0 = ones of seconds (h)
-
-
-  /* Middle pair (HEX2, HEX3) = minutes */
-  set_display_digit(3, (minutes / 10) % 10);  // HEX3 = tens of minutes (h)
-  set_display_digit(2,  minutes % 10);        // HEX2 = ones of minutes (h)
-
-
-  /* Left pair (HEX4, HEX5) = hours */
-  set_display_digit(5, (hours   / 10) % 10);  // HEX5 = tens of hours (h)
-  set_display_digit(4,  hours   % 10);        // HEX4 = ones of hours (h)
-}
-
 
 
 
 void labinit(void) { // Optional init hook (a)(b)
-  // No hardware init required for A1 (a)(b)
- 
+  timing_calibrate(); // once at boot: how many mcycles is a millisecond on this board
+#ifdef SYSCALL_REPORT
+  syscall_report(); // build with -DSYSCALL_REPORT: ecall vs direct print cost in cycles
+#endif
+
 }
 
 
@@ -199,6 +141,7 @@ int main(void) { // (a)-(h)
 #if !STOP_AFTER_START_SEQUENCE // if we didn't halt
   /* (h) running clock with 7-seg + button/switch control */
   int hours = 0, minutes = 0, seconds = 0; // intialize the time to 0, software clock state (h)
+  unsigned next_second = now_us() + 1000000; // absolute deadline of the next tick
 
 
   while (1) { // main polling loop (h)
@@ -211,8 +154,11 @@ int main(void) { // (a)-(h)
     display_string(textstring);        // print to terminal (a)(b)
     print("\n");                       // newline (a)(b)
    
-    /* Approximate 1 “second” tick */
-    delay(2); // wait about a second (scale from Lab1) (a)(b)(h)
+    /* Wait for the next whole second. The deadline is absolute (previous deadline + 1 s),
+       so however long the printing above took, the clock never drifts. If we ever fall
+       more than a second behind, the next rounds don't wait until we have caught up. */
+    while ((int)(now_us() - next_second) < 0);
+    next_second += 1000000;
     tick(&mytime); //increament mytime (Lab1 routine) (a)(b)
 
 
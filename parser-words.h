@@ -0,0 +1,50 @@
+/* parser-words.h - the vocabulary of parser.c as a perfect hash table.
+   Generated by host/ph-gen.c (make parser-words), don't edit: change
+   the word list there and regenerate. */
+#if PH_BITS != 6
+#error "parser-words.h was generated for another PH_BITS, run make parser-words"
+#endif
+
+#define PH_SEED 0x3817d6u   /* smallest seed that gives every word its own slot */
+
+static const struct word words[PH_SIZE] = {
+  [ 1] = { 0x4674caeeu, WORD_ACTION, 3,           "profile" },
+  [ 2] = { 0xccff7e48u, WORD_SYSTEM, CMD_SAVE,    "save" },
+  [ 6] = { 0xb554f920u, WORD_ITEM,   1,           "silver" },
+  [ 9] = { 0xf20c3f36u, WORD_DIR,    3,           "w" },
+  [10] = { 0xab3a8a0au, WORD_NOISE,  0,           "off" },
+  [13] = { 0x42454824u, WORD_NOISE,  0,           "to" },
+  [14] = { 0x5791c4f4u, WORD_VERB,   CMD_USE,     "use" },
+  [18] = { 0x0e272d7au, WORD_DIR,    1,           "south" },
+  [19] = { 0xe40c292cu, WORD_NOISE,  0,           "a" },
+  [20] = { 0xdaef9304u, WORD_DIR,    0,           "north" },
+  [23] = { 0x0053723cu, WORD_DIR,    2,           "east" },
+  [24] = { 0xec0c35c4u, WORD_ACTION, 1,           "i" },
+  [25] = { 0xe66176f9u, WORD_VERB,   VERB_TRAVEL, "travel" },
+  [27] = { 0x650d33c0u, WORD_SYSTEM, CMD_RESET,   "reset" },
+  [28] = { 0xe00c22e0u, WORD_DIR,    2,           "e" },
+  [29] = { 0x57251588u, WORD_NOISE,  0,           "at" },
+  [30] = { 0x93e97b38u, WORD_ACTION, 1,           "inv" },
+  [31] = { 0xf60c4582u, WORD_DIR,    1,           "s" },
+  [32] = { 0x0a339056u, WORD_VERB,   CMD_TAKE,    "take" },
+  [34] = { 0xe29d1e2fu, WORD_ITEM,   0,           "light" },
+  [35] = { 0xeb0c3431u, WORD_DIR,    0,           "n" },
+  [36] = { 0x6815c86cu, WORD_NOISE,  0,           "key" },
+  [38] = { 0xfcfdc43fu, WORD_ACTION, 1,           "inventory" },
+  [39] = { 0x61342fd0u, WORD_NOISE,  0,           "on" },
+  [40] = { 0xe90c310bu, WORD_ACTION, 0,           "l" },
+  [42] = { 0x540ca757u, WORD_VERB,   CMD_TAKE,    "get" },
+  [43] = { 0xeae949aeu, WORD_DIR,    3,           "west" },
+  [45] = { 0xe7060113u, WORD_ITEM,   0,           "flashlight" },
+  [46] = { 0xb40eb21cu, WORD_NOISE,  0,           "the" },
+  [47] = { 0xa0262210u, WORD_VERB,   CMD_GO,      "walk" },
+  [51] = { 0xe60759e9u, WORD_ACTION, 2,           "load" },
+  [53] = { 0xae349521u, WORD_ITEM,   0,           "torch" },
+  [55] = { 0xe6ef5696u, WORD_ACTION, 0,           "look" },
+  [56] = { 0x4220774bu, WORD_VERB,   CMD_GO,      "go" },
+  [57] = { 0x43430b20u, WORD_NOISE,  0,           "up" },
+  [58] = { 0xa19a8c3fu, WORD_VERB,   CMD_TAKE,    "grab" },
+  [60] = { 0xf5a30fe6u, WORD_VERB,   VERB_TRAVEL, "goto" },
+  [62] = { 0x9e19b1eau, WORD_ITEM,   2,           "brass" },
+  [63] = { 0x37fd327au, WORD_NOISE,  0,           "room" },
+};
@@ -0,0 +1,230 @@
+#include "parser.h"
+
+/* Line input. Characters come from the JTAG UART receive FIFO (or from
+   parser_feed directly, the benchmark does that) and are collected into one
+   line buffer. The tokenizer never copies: words are (pointer, length)
+   pairs into that buffer. */
+static char line[PARSER_LINE_MAX];
+static unsigned line_len;
+static int line_too_long;
+
+/* Vocabulary as a perfect hash table. Every word is hashed with 32-bit
+   FNV-1a (letters folded to lower case with | 0x20), PH_SLOT picks its slot.
+   The table and PH_SEED come from host/ph-gen.c (make parser-words), which
+   searches the smallest seed that puts all words into different slots, so a
+   lookup is one hash, one load and one compare of the full 32-bit hash,
+   never a string compare. The text column is only read by parser_check,
+   which redoes the hashing (game-host, explore and make bench run it). */
+#define FNV_BASIS 2166136261u   /* hash and PH_SLOT: same in host/ph-gen.c */
+#define FNV_PRIME 16777619u
+
+#define PH_BITS 6
+#define PH_SIZE (1 << PH_BITS)
+#define PH_SLOT(h) ((((h) ^ PH_SEED) * 0x9E3779B1u) >> (32 - PH_BITS))
+
+#define VERB_TRAVEL 4   /* "travel"/"goto", the one verb that is not a switch command type */
+#define VERB_SYSTEM 5   /* "save"/"reset", stands for its whole command code */
+
+enum word_kind {
+  WORD_NONE,     /* empty slot */
+  WORD_VERB,     /* value = command type or VERB_TRAVEL */
+  WORD_DIR,      /* value = direction, 0 north .. 3 west */
+  WORD_ITEM,     /* value = item id in game.c items[] */
+  WORD_ACTION,   /* a CMD_OTHER command on its own, value = its argument */
+  WORD_NOISE,    /* allowed but ignored ("take THE brass KEY") */
+  WORD_SYSTEM,   /* a command on its own, value = its command code (CMD_SAVE, CMD_RESET) */
+  WORD_NUMBER    /* not in the table, a word of digits ("travel to room 7") */
+};
+
+struct word {
+  unsigned hash;
+  unsigned char kind;
+  unsigned char value;
+  const char *text;
+};
+
+#include "parser-words.h"
+
+/* The kind of object each verb needs */
+static const unsigned char object_kind[VERB_SYSTEM + 1] = {
+  [CMD_GO]      = WORD_DIR,
+  [CMD_TAKE]    = WORD_ITEM,
+  [CMD_USE]     = WORD_ITEM,
+  [CMD_OTHER]   = WORD_ACTION,
+  [VERB_TRAVEL] = WORD_NUMBER,
+  [VERB_SYSTEM] = WORD_SYSTEM,
+};
+
+/* function: parser_feed
+   Description: Adds one character to the line being typed. Returns 1 when
+   the line is complete (CR or LF), then parser_line hands it out.
+   Backspace/DEL remove the last character. */
+int parser_feed(char c)
+{
+  if (c == '\r' || c == '\n') {
+    if (line_too_long) {
+      print("Line too long, ignored.\n");
+      line_too_long = 0;
+      line_len = 0;
+      return 0;
+    }
+    return 1;
+  }
+  if (c == '\b' || c == 0x7f) {
+    if (line_len != 0) line_len--;
+    return 0;
+  }
+  if (line_len == PARSER_LINE_MAX) {
+    line_too_long = 1;
+    return 0;
+  }
+  line[line_len++] = c;
+  return 0;
+}
+
+/* function: parser_poll
+   Description: Moves everything the JTAG UART has received into the line
+   buffer, echoing it. Never waits. Returns 1 as soon as a line is complete,
+   the rest stays in the receive FIFO for the next call. */
+int parser_poll(void)
+{
+  static char prev;
+  int c;
+
+  while ((c = uart_getc()) >= 0) {
+    if (c == '\n' && prev == '\r') {   /* CR LF is one line end */
+      prev = c;
+      continue;
+    }
+    prev = c;
+    if (c == '\b' || c == 0x7f) {
+      if (line_len != 0) print_lit("\b \b");
+    } else {
+      printc(c == '\r' ? '\n' : c);
+    }
+    if (parser_feed(c))
+      return 1;
+  }
+  return 0;
+}
+
+/* function: parser_line
+   Description: The completed line. It stays valid until the next
+   parser_feed, which starts a new one. */
+const char *parser_line(unsigned *len)
+{
+  *len = line_len;
+  line_len = 0;
+  return line;
+}
+
+/* function: parse_command
+   Description: Splits s[0..len) into words at blanks, in place, hashing each
+   word while scanning it. Returns the command code (same encoding as the
+   switches, see CMD) or one of the PARSE_ results. On PARSE_UNKNOWN,
+   *unknown points at the word that is not in the vocabulary.
+   A direction on its own means go ("north", "n"), a number is only taken
+   by travel. */
+int parse_command(const char *s, unsigned len, struct lstr *unknown)
+{
+  const char *end = s + len;
+  const char *w;
+  int verb = -1, arg = 0, arg_kind = WORD_NONE, seen = 0;
+
+  while (s != end) {
+    if ((unsigned char) *s <= ' ') {   /* blanks, tabs, stray control characters */
+      s++;
+      continue;
+    }
+
+    w = s;
+    if (*s >= '0' && *s <= '9') {
+      unsigned x = 0;
+      do {
+        x = x * 10 + (*s - '0');
+        s++;
+      } while (s != end && *s >= '0' && *s <= '9' && x < 100000);
+      if (s != end && (unsigned char) *s > ' ')
+        goto unknown_word;              /* "7th", or far too many digits */
+      arg = x;
+      arg_kind = WORD_NUMBER;
+      seen = 1;
+      continue;
+    }
+
+    unsigned h = FNV_BASIS;
+    do {
+      h = (h ^ (unsigned char) (*s | 0x20)) * FNV_PRIME;
+      s++;
+    } while (s != end && (unsigned char) *s > ' ');
+
+    const struct word *e = &words[PH_SLOT(h)];
+    unsigned kind = e->hash == h ? e->kind : WORD_NONE;
+    switch (kind) {
+    case WORD_VERB:
+      verb = e->value;
+      break;
+    case WORD_DIR:
+    case WORD_ITEM:
+      arg = e->value;
+      arg_kind = kind;
+      break;
+    case WORD_ACTION:
+      verb = CMD_OTHER;
+      arg = e->value;
+      arg_kind = kind;
+      break;
+    case WORD_SYSTEM:
+      verb = VERB_SYSTEM;
+      arg = e->value;
+      arg_kind = kind;
+      break;
+    case WORD_NOISE:
+      break;
+    default:
+      goto unknown_word;
+    }
+    seen = 1;
+  }
+
+  if (!seen)
+    return PARSE_EMPTY;
+  if (verb < 0 && arg_kind == WORD_DIR)
+    verb = CMD_GO;
+  if (verb < 0 || arg_kind != object_kind[verb])
+    return PARSE_WHAT;
+  if (verb == VERB_TRAVEL)
+    return arg <= CMD_ROOM_MAX ? CMD_TRAVEL_TO(arg) : PARSE_WHAT;
+  if (verb == VERB_SYSTEM)
+    return arg;
+  if (arg_kind == WORD_ITEM)
+    return CMD_ITEM(verb, arg);
+  return CMD(verb, arg);
+
+unknown_word:
+  while (s != end && (unsigned char) *s > ' ')
+    s++;
+  unknown->s = w;
+  unknown->len = s - w;
+  return PARSE_UNKNOWN;
+}
+
+/* function: parser_check
+   Description: Rehashes the text of every vocabulary entry and checks that
+   the stored hash and the slot are right. Returns the number of bad entries. */
+unsigned parser_check(void)
+{
+  unsigned bad = 0;
+
+  for (unsigned i = 0; i < PH_SIZE; i++) {
+    const char *t = words[i].text;
+    if (t == 0)
+      continue;
+    unsigned h = FNV_BASIS;
+    while (*t != '\0')
+      h = (h ^ (unsigned char) (*t++ | 0x20)) * FNV_PRIME;
+    if (h != words[i].hash || PH_SLOT(h) != i || words[i].kind == WORD_NONE)
+      bad++;
+  }
+  return bad;
+}
@@ -0,0 +1,47 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "dtekv-lib.h"
+
+/* Typed commands from the JTAG UART ("go north", "take brass key").
+   A parsed line becomes the same command code the switches give, so typed
+   and switch commands end up in the same handlers. */
+
+#define PARSER_LINE_MAX 64     /* longer lines are thrown away */
+
+/* Command codes: SW3..SW2 = command type, SW1..SW0 = argument */
+#define CMD(type, arg) (((type) << 2) | (arg))
+
+#define CMD_GO    0
+#define CMD_TAKE  1
+#define CMD_USE   2
+#define CMD_OTHER 3
+
+/* Travel: SW4 on, SW3..SW0 off, destination room number on SW9..SW5 */
+#define CMD_TRAVEL     0x10
+#define CMD_ROOM_SHIFT 5
+#define CMD_ROOM_MAX   (0x3ff >> CMD_ROOM_SHIFT)
+#define CMD_TRAVEL_TO(room) (CMD_TRAVEL | (room) << CMD_ROOM_SHIFT)
+
+/* Take and use: SW3..SW2 = CMD_TAKE or CMD_USE with SW1..SW0 off, item id on
+   SW9..SW5, so item ids never run into the next command type */
+#define CMD_ITEM_SHIFT 5
+#define CMD_ITEM_MAX   (0x3ff >> CMD_ITEM_SHIFT)
+#define CMD_ITEM(type, item) (CMD(type, 0) | (item) << CMD_ITEM_SHIFT)
+
+/* Saved game (save.c), on codes travel leaves free: SW4 with SW0 or SW1 */
+#define CMD_SAVE  0x11         /* show the saved game as hex */
+#define CMD_RESET 0x12         /* soft reset, the game comes back from the save */
+
+/* parse_command results that are not a command code */
+#define PARSE_EMPTY   -1       /* nothing but blanks */
+#define PARSE_UNKNOWN -2       /* a word not in the vocabulary, see *unknown */
+#define PARSE_WHAT    -3       /* verb without a fitting object, or object without a verb */
+
+int parser_feed(char c);
+int parser_poll(void);
+const char *parser_line(unsigned *len);
+int parse_command(const char *s, unsigned len, struct lstr *unknown);
+unsigned parser_check(void);
+
+#endif
@@ -0,0 +1,101 @@
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include "dtekv-lib.h"
+
+/* Histogram bucket b counts calls of [2^(b+6), 2^(b+7)) cycles,
+   bucket 0 also takes everything shorter and the last one everything longer. */
+#define PROF_BUCKETS 16
+#define PROF_BUCKET_SHIFT 7
+
+struct prof_entry {
+  unsigned count;
+  unsigned min, max;
+  unsigned sum_lo, sum_hi;        /* 64-bit cycle sum, kept by hand (no libgcc) */
+  unsigned instret_sum;
+  unsigned hist[PROF_BUCKETS];
+};
+
+static struct prof_entry table[PROF_COUNT];
+
+static const char *const names[PROF_COUNT] = {
+  "command   ",
+  "print_room",
+  "go        ",
+  "take      ",
+  "use       ",
+};
+
+void prof_record(enum prof_id id, const struct prof_stamp *start)
+{
+  struct prof_stamp end = prof_now();
+  unsigned cycles = end.cycles - start->cycles;
+  struct prof_entry *e = &table[id];
+
+  if (e->count == 0 || cycles < e->min) e->min = cycles;
+  if (cycles > e->max) e->max = cycles;
+  e->count++;
+  e->sum_lo += cycles;
+  if (e->sum_lo < cycles) e->sum_hi++;
+  e->instret_sum += end.instret - start->instret;
+
+  unsigned b = 0, v = cycles >> PROF_BUCKET_SHIFT;
+  while (v != 0 && b < PROF_BUCKETS - 1) {
+    v >>= 1;
+    b++;
+  }
+  e->hist[b]++;
+}
+
+/* Mean of a 64-bit sum over count using only 32-bit division:
+   halve both until the sum fits in 32 bits. */
+static unsigned mean(unsigned lo, unsigned hi, unsigned count)
+{
+  while (hi != 0) {
+    lo = (lo >> 1) | (hi << 31);
+    hi >>= 1;
+    count >>= 1;
+  }
+  return count ? lo / count : 0;
+}
+
+/* function: prof_dump
+   Description: Prints count/min/mean/max cycles, mean instructions and the
+   non-empty histogram buckets (as lower bound in hex) for every entry. */
+void prof_dump(void)
+{
+  print("\nprofile       calls      min     mean      max  instret\n");
+  for (int i = 0; i < PROF_COUNT; i++) {
+    struct prof_entry *e = &table[i];
+    print((char*) names[i]);
+    print("  "); print_dec(e->count);
+    if (e->count == 0) {
+      printc('\n');
+      continue;
+    }
+    print("  "); print_dec(e->min);
+    print("  "); print_dec(mean(e->sum_lo, e->sum_hi, e->count));
+    print("  "); print_dec(e->max);
+    print("  "); print_dec(e->instret_sum / e->count);
+    print("\n    hist:");
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+      if (e->hist[b] == 0) continue;
+      printc(' ');
+      print_hex32(b == 0 ? 0 : 1u << (b + PROF_BUCKET_SHIFT - 1));
+      printc(':');
+      print_dec(e->hist[b]);
+    }
+    printc('\n');
+  }
+}
+
+void prof_reset(void)
+{
+  /* word by word: a struct assignment could turn into a memset call, and we link without libc */
+  unsigned *p = (unsigned*) table;
+  for (unsigned i = 0; i < sizeof(table) / (sizeof(unsigned)); i++)
+    p[i] = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* Cycle/instruction profiling of the game commands.
+   Build with PROFILE=1 (-DPROFILE). Without it every PROF_ macro is empty
+   and none of profile.c is compiled, so normal images pay nothing. */
+
+enum prof_id {
+  PROF_COMMAND,       /* whole run_switch_command */
+  PROF_PRINT_ROOM,
+  PROF_GO,
+  PROF_TAKE,
+  PROF_USE,
+  PROF_COUNT
+};
+
+#ifdef PROFILE
+
+struct prof_stamp {
+  unsigned cycles;
+  unsigned instret;
+};
+
+static inline struct prof_stamp prof_now(void)
+{
+  struct prof_stamp s;
+  asm volatile ("csrr %0, mcycle" : "=r"(s.cycles));
+  asm volatile ("csrr %0, minstret" : "=r"(s.instret));
+  return s;
+}
+
+void prof_record(enum prof_id id, const struct prof_stamp *start);
+void prof_dump(void);
+void prof_reset(void);
+
+#define PROF_BEGIN(id) struct prof_stamp prof_start_##id = prof_now()
+#define PROF_END(id)   prof_record(id, &prof_start_##id)
+
+#else
+
+#define PROF_BEGIN(id)
+#define PROF_END(id)
+
+#endif
+
+#endif
@@ -0,0 +1,136 @@
+#include "route.h"
+
+#define NEXT_WORDS ((ROUTE_MAX_ROOMS + 15) / 16)   /* 16 two-bit directions per word */
+#define BIT_WORDS  ((ROUTE_MAX_ROOMS + 31) / 32)
+
+#define BIT(set, i) (((set)[(i) >> 5] >> ((i) & 31)) & 1)
+
+static unsigned num_rooms;
+
+/* One row per destination, indexed by the room the player is in */
+static uint32_t next_hop[ROUTE_MAX_ROOMS][NEXT_WORDS];
+static uint32_t reach[ROUTE_MAX_ROOMS][BIT_WORDS];
+
+static uint32_t blocked[BIT_WORDS];
+static uint32_t dirty[BIT_WORDS];      /* rows that must be rebuilt before use */
+static unsigned rebuilds;
+
+/* Reverse edges: the exits leading into room v are pred[pred_start[v] ..
+   pred_start[v + 1]), each stored as room << 2 | direction. */
+static uint32_t pred_start[ROUTE_MAX_ROOMS + 1];   /* up to 4 * ROUTE_MAX_ROOMS */
+static uint16_t pred[ROUTE_MAX_ROOMS * 4];
+static uint16_t queue[ROUTE_MAX_ROOMS];
+
+/* BFS backwards from dest. A room that is reached gets the direction of its
+   first step and is only expanded further if it can be entered, so a blocked
+   room can be left but never walked through. */
+static void build_row(unsigned dest)
+{
+  uint32_t *next = next_hop[dest];
+  uint32_t *r = reach[dest];
+  unsigned head = 0, tail = 0;
+
+  for (unsigned i = 0; i < BIT_WORDS; i++)
+    r[i] = 0;
+  r[dest >> 5] |= 1u << (dest & 31);
+  dirty[dest >> 5] &= ~(1u << (dest & 31));
+  rebuilds++;
+  if (BIT(blocked, dest))
+    return;
+
+  queue[tail++] = dest;
+  while (head != tail) {
+    unsigned v = queue[head++];
+    for (unsigned e = pred_start[v]; e != pred_start[v + 1]; e++) {
+      unsigned u = pred[e] >> 2, dir = pred[e] & 3;
+      if (BIT(r, u))
+        continue;
+      r[u >> 5] |= 1u << (u & 31);
+      next[u >> 4] = (next[u >> 4] & ~(3u << ((u & 15) * 2))) | (dir << ((u & 15) * 2));
+      if (!BIT(blocked, u))
+        queue[tail++] = u;
+    }
+  }
+}
+
+/* function: route_init
+   Description: Builds the reverse edges of the room graph and every row.
+   exits and blocked_rooms ((n + 31) / 32 words) are only read here.
+   Returns 0 if the world has more than ROUTE_MAX_ROOMS rooms or an exit
+   leads past the last room; then there are no routes at all (route_next
+   says ROUTE_NONE) until a route_init succeeds. */
+int route_init(unsigned n, const int16_t (*exits)[4], const uint32_t *blocked_rooms)
+{
+  num_rooms = 0;
+  if (n > ROUTE_MAX_ROOMS)
+    return 0;
+  for (unsigned u = 0; u < n; u++)
+    for (unsigned d = 0; d < 4; d++)
+      if (exits[u][d] >= (int) n)
+        return 0;
+
+  for (unsigned i = 0; i < BIT_WORDS; i++)
+    blocked[i] = i < (n + 31) / 32 ? blocked_rooms[i] : 0;
+
+  /* counting sort of the exits by the room they lead to,
+     queue[] is borrowed for the fill count of each room */
+  for (unsigned v = 0; v <= n; v++)
+    pred_start[v] = 0;
+  for (unsigned v = 0; v < n; v++)
+    queue[v] = 0;
+  for (unsigned u = 0; u < n; u++)
+    for (unsigned d = 0; d < 4; d++)
+      if (exits[u][d] >= 0)
+        pred_start[exits[u][d] + 1]++;
+  for (unsigned v = 0; v < n; v++)
+    pred_start[v + 1] += pred_start[v];
+  for (unsigned u = 0; u < n; u++)
+    for (unsigned d = 0; d < 4; d++)
+      if (exits[u][d] >= 0)
+        pred[queue[exits[u][d]]++ + pred_start[exits[u][d]]] = u << 2 | d;
+
+  for (unsigned v = 0; v < n; v++)
+    build_row(v);
+  num_rooms = n;
+  return 1;
+}
+
+/* function: route_set_blocked
+   Description: Marks a room as blocked or enterable again. Only the rows
+   whose routes can change are marked dirty: those the room can reach (a
+   path through it may appear or disappear) and its own. */
+void route_set_blocked(unsigned room, int on)
+{
+  uint32_t bit = 1u << (room & 31);
+  if (room >= num_rooms || !!(blocked[room >> 5] & bit) == !!on)
+    return;
+  blocked[room >> 5] ^= bit;
+
+  for (unsigned d = 0; d < num_rooms; d++)
+    if (d == room || BIT(reach[d], room))
+      dirty[d >> 5] |= 1u << (d & 31);
+}
+
+/* function: route_next
+   Description: Direction (0 north .. 3 west) of the first step on a
+   shortest path, ROUTE_HERE or ROUTE_NONE (also for rooms route_init
+   doesn't know). */
+int route_next(unsigned from, unsigned to)
+{
+  if (from >= num_rooms || to >= num_rooms)
+    return ROUTE_NONE;
+  if (from == to)
+    return ROUTE_HERE;
+  if (BIT(dirty, to))
+    build_row(to);
+  if (!BIT(reach[to], from))
+    return ROUTE_NONE;
+  return (next_hop[to][from >> 4] >> ((from & 15) * 2)) & 3;
+}
+
+/* function: route_rebuilds
+   Description: Number of rows built so far, to see what an unlock costs. */
+unsigned route_rebuilds(void)
+{
+  return rebuilds;
+}
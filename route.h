@@ -0,0 +1,28 @@
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <stdint.h>
+
+/* Shortest paths between rooms, for the travel command.
+   For every destination there is a row with the direction to take from
+   each room (2 bits) and whether the destination can be reached from it
+   (1 bit), so about 3 bits per pair of rooms: 1.5 KiB for 64 rooms,
+   6 MiB for 4096. Rows are built by a BFS at route_init and rebuilt on
+   demand after a room changes between enterable and blocked. */
+#ifndef ROUTE_MAX_ROOMS
+#define ROUTE_MAX_ROOMS 64     /* enough for the game; make ROUTE_ROOMS=n, at most 16384 */
+#endif
+
+#define ROUTE_NONE -1          /* no way from here to there */
+#define ROUTE_HERE -2          /* already there */
+
+/* exits[room][dir] = room behind that exit or -1, dir 0 north .. 3 west.
+   blocked: bit per room that can't be entered (locked, or dark without light).
+   route_init returns 0 for a world it can't route (too many rooms, or an
+   exit past the last room), the caller must check. */
+int route_init(unsigned num_rooms, const int16_t (*exits)[4], const uint32_t *blocked);
+void route_set_blocked(unsigned room, int blocked);
+int route_next(unsigned from, unsigned to);
+unsigned route_rebuilds(void);
+
+#endif
@@ -0,0 +1,130 @@
+#include "save.h"
+#include "game.h"
+#include "dtekv-lib.h"
+
+#define SAVE_MAGIC   0x5653484du   /* "MHSV" in memory */
+#define SAVE_VERSION 1             /* bump when the record or GAME_SAVE_WORDS changes */
+
+struct save_record {
+  unsigned magic;
+  unsigned short version;
+  unsigned short size;             /* sizeof(struct save_record) */
+  unsigned seq;                    /* counts the saves, the newer slot wins */
+  unsigned state[GAME_SAVE_WORDS]; /* game_save */
+  unsigned crc;                    /* CRC-32 of everything above */
+};
+
+#define SAVE_CRC_WORDS (sizeof(struct save_record) / sizeof(unsigned) - 1)
+
+/* Two slots, written in turn, so a reset in the middle of a save still
+   leaves the previous one. .noinit is outside the loaded image
+   (dtekv-script.lds) and boot.S only clears .bss, so the slots keep their
+   contents over a soft reset. After power-up they hold garbage, which the
+   magic and the CRC catch. */
+static struct save_record slots[2] __attribute__((section(".noinit")));
+static unsigned seq;               /* seq of the next save, its slot is seq & 1 */
+
+/* CRC-32 (the zlib/Ethernet one, reflected 0xEDB88320) with a byte table,
+   built on the first use instead of sitting in the source. The record is
+   read a word at a time, four table steps per load; on a little-endian CPU
+   that is the same CRC as going byte by byte. */
+static unsigned crc_table[256];
+
+static void crc_init(void)
+{
+  for (unsigned i = 0; i < 256; i++) {
+    unsigned c = i;
+    for (int k = 0; k < 8; k++)
+      c = (c & 1) ? (c >> 1) ^ 0xedb88320u : c >> 1;
+    crc_table[i] = c;
+  }
+}
+
+static unsigned crc32(const unsigned *w, unsigned words)
+{
+  unsigned crc = ~0u;
+  if (crc_table[1] == 0)
+    crc_init();
+  while (words--) {
+    crc ^= *w++;
+    crc = (crc >> 8) ^ crc_table[crc & 0xff];
+    crc = (crc >> 8) ^ crc_table[crc & 0xff];
+    crc = (crc >> 8) ^ crc_table[crc & 0xff];
+    crc = (crc >> 8) ^ crc_table[crc & 0xff];
+  }
+  return ~crc;
+}
+
+static int record_ok(const struct save_record *r)
+{
+  return r->magic == SAVE_MAGIC && r->version == SAVE_VERSION &&
+         r->size == sizeof(struct save_record) && r->crc == crc32((const unsigned *) r, SAVE_CRC_WORDS);
+}
+
+/* function: save_game
+   Description: Saves the running game into the older slot: ten word stores
+   and a CRC over nine words, about 300 cycles, cheap enough to run after
+   every command. */
+void save_game(void)
+{
+  struct save_record *r = &slots[seq & 1];
+  r->magic = SAVE_MAGIC;
+  r->version = SAVE_VERSION;
+  r->size = sizeof(struct save_record);
+  r->seq = seq++;
+  game_save(r->state);
+  r->crc = crc32((const unsigned *) r, SAVE_CRC_WORDS);
+}
+
+/* function: save_restore
+   Description: Continues the newest good saved game, if there is one. Call
+   after game_init. Returns 1 if a game was restored. */
+int save_restore(void)
+{
+  const struct save_record *best = 0;
+
+  for (unsigned i = 0; i < 2; i++) {
+    const struct save_record *r = &slots[i];
+    if (record_ok(r) && (best == 0 || (int) (r->seq - best->seq) > 0))
+      best = r;
+  }
+  if (best == 0 || !game_restore(best->state)) {
+    seq = 0;
+    return 0;
+  }
+  seq = best->seq + 1;
+  return 1;
+}
+
+/* function: save_erase
+   Description: Forgets both slots (a finished game is not worth restoring). */
+void save_erase(void)
+{
+  slots[0].magic = 0;
+  slots[1].magic = 0;
+  seq = 0;
+}
+
+/* function: save_dump
+   Description: Prints both slots word by word in hex, with whether each one
+   would be restored. */
+void save_dump(void)
+{
+  for (unsigned i = 0; i < 2; i++) {
+    const struct save_record *r = &slots[i];
+    const unsigned *w = (const unsigned *) r;
+    print("slot ");
+    print_dec(i);
+    if (record_ok(r)) {
+      print(", save ");
+      print_dec(r->seq);
+    } else {
+      print(", empty or damaged");
+    }
+    for (unsigned k = 0; k < sizeof(*r) / sizeof(unsigned); k++) {
+      print(k % 5 == 0 ? "\n  " : " ");
+      print_hex32(w[k]);
+    }
+    printc('\n');
+  }
+}
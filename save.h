@@ -0,0 +1,11 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+/* Saved game in RAM that survives a soft reset (soft_reset, the "reset"
+   command): a fixed-size record with a version and a CRC-32, see save.c */
+void save_game(void);
+int save_restore(void);
+void save_erase(void);
+void save_dump(void);
+
+#endif
@@ -0,0 +1,162 @@
+#include "sched.h"
+#include "timer.h"
+#include "idle.h"
+#include "input.h"
+#include "dtekv-lib.h"
+
+/* The tick is the timer interrupt, which input_init starts */
+#define SCHED_TICK_US INPUT_SAMPLE_US
+
+static struct task *tasks[SCHED_MAX_TASKS];
+static unsigned num_tasks;
+static volatile int running;
+static unsigned start_tick;        /* timer_ticks when sched_run started */
+
+/* Time a is before time b, also across the wrap of timer_ticks */
+static inline int before(unsigned a, unsigned b)
+{
+  return (int) (a - b) < 0;
+}
+
+/* function: sched_add
+   Description: Releases t for the first time delay ticks from now, and then
+   every t->period ticks. A one-shot task (period 0) is removed once it has
+   run. Adding a task that is already there only moves its release. */
+void sched_add(struct task *t, unsigned delay)
+{
+  t->release = timer_ticks + delay;
+  for (unsigned i = 0; i < num_tasks; i++)
+    if (tasks[i] == t)
+      return;
+  if (num_tasks < SCHED_MAX_TASKS) {
+    /* task structs are initialized data, which a soft reset doesn't reload */
+    t->runs = t->misses = t->max_cycles = 0;
+    t->sum_lo = t->sum_hi = 0;
+    tasks[num_tasks++] = t;
+  }
+}
+
+/* function: sched_remove
+   Description: Takes t off the list, it does not run again until it is
+   added again. Tasks may remove themselves and others while they run. */
+void sched_remove(struct task *t)
+{
+  for (unsigned i = 0; i < num_tasks; i++) {
+    if (tasks[i] == t) {
+      tasks[i] = tasks[--num_tasks];
+      return;
+    }
+  }
+}
+
+/* The released task with the earliest deadline, or NULL */
+static struct task *next_task(void)
+{
+  unsigned now = timer_ticks;
+  struct task *best = 0;
+
+  for (unsigned i = 0; i < num_tasks; i++) {
+    struct task *t = tasks[i];
+    if (before(now, t->release))
+      continue;
+    if (best == 0 || before(t->release + t->deadline, best->release + best->deadline))
+      best = t;
+  }
+  return best;
+}
+
+/* For idle_wait: called with interrupts off */
+static int task_due(void)
+{
+  return next_task() != 0;
+}
+
+/* function: sched_run
+   Description: Runs tasks until sched_stop. A task that is due runs to the
+   end, so a slow one delays the others. Releases stay on their grid (the
+   last one plus the period), so nothing drifts: after a delay a catch_up
+   task runs back to back until it is on time again, the others skip the
+   releases whose deadline has already gone by. Every run that ends after its
+   deadline and every skipped release counts as a miss for sched_report. */
+void sched_run(void)
+{
+  running = 1;
+  start_tick = timer_ticks;
+  while (running) {
+    struct task *t = next_task();
+    if (t == 0) {
+      idle_wait(task_due);   /* the timer wakes us every tick */
+      continue;
+    }
+
+    unsigned deadline = t->release + t->deadline;
+    if (t->period != 0)
+      t->release += t->period;
+    else
+      sched_remove(t);
+
+    unsigned c0 = read_mcycle();
+    t->run();
+    unsigned cycles = read_mcycle() - c0;
+
+    t->runs++;
+    if (cycles > t->max_cycles) t->max_cycles = cycles;
+    t->sum_lo += cycles;
+    if (t->sum_lo < cycles) t->sum_hi++;
+    if (before(deadline, timer_ticks))
+      t->misses++;
+    if (t->period != 0 && !t->catch_up) {
+      while (before(t->release + t->deadline, timer_ticks)) {
+        t->release += t->period;
+        t->misses++;
+      }
+    }
+  }
+}
+
+/* function: sched_stop
+   Description: sched_run returns once the running task is done. */
+void sched_stop(void)
+{
+  running = 0;
+}
+
+/* A 64-bit sum divided by d using only 32-bit division:
+   halve both until the sum fits in 32 bits. */
+static unsigned div64(unsigned lo, unsigned hi, unsigned d)
+{
+  while (hi != 0) {
+    lo = (lo >> 1) | (hi << 31);
+    hi >>= 1;
+    d >>= 1;
+  }
+  return d ? lo / d : 0;
+}
+
+/* function: sched_report
+   Description: Prints runs, deadline misses, mean and max cycles per run and
+   the share of the time since sched_run started for every task (tasks that
+   are off the list, like a one-shot that has run, are not shown). */
+void sched_report(void)
+{
+  unsigned elapsed = timer_ticks - start_tick;
+  unsigned tick_cycles = cycles_per_ms * SCHED_TICK_US / 1000;
+
+  print("\ntask      runs  misses     mean      max  cpu%\n");
+  for (unsigned i = 0; i < num_tasks; i++) {
+    struct task *t = tasks[i];
+    unsigned ticks = div64(t->sum_lo, t->sum_hi, tick_cycles);
+    unsigned n = 0;
+    print((char *) t->name);
+    while (t->name[n] != '\0')
+      n++;
+    while (n++ < 8)
+      printc(' ');
+    print_dec_pad(t->runs, 6, ' ');
+    print_dec_pad(t->misses, 8, ' ');
+    print_dec_pad(div64(t->sum_lo, t->sum_hi, t->runs), 9, ' ');
+    print_dec_pad(t->max_cycles, 9, ' ');
+    print_dec_pad(elapsed ? ticks * 100 / elapsed : 0, 6, ' ');
+    printc('\n');
+  }
+}
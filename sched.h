@@ -0,0 +1,33 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+/* Cooperative deadline scheduler. Tasks run to completion in the main loop,
+   the one whose deadline comes first goes first, and the CPU sleeps in wfi
+   while nothing is due. Time is counted in timer interrupts (timer_ticks),
+   1 ms with the timer input_init starts. */
+
+struct task {
+  const char *name;
+  void (*run)(void);
+  unsigned period;      /* ticks between releases, 0 = one-shot */
+  unsigned deadline;    /* ticks after the release it has to be done by */
+  int catch_up;         /* after a delay, run once for every release missed
+                           (the clock) instead of skipping them */
+
+  /* kept by the scheduler */
+  unsigned release;     /* tick of the next release */
+  unsigned runs;
+  unsigned misses;      /* runs that finished after their deadline */
+  unsigned max_cycles;
+  unsigned sum_lo, sum_hi;   /* 64-bit cycle sum, kept by hand (no libgcc) */
+};
+
+#define SCHED_MAX_TASKS 8
+
+void sched_add(struct task *t, unsigned delay);
+void sched_remove(struct task *t);
+void sched_run(void);
+void sched_stop(void);
+void sched_report(void);
+
+#endif
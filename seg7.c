@@ -0,0 +1,137 @@
+/* seg7.c - 7-segment display driver: framebuffer, font and marquee (see seg7.h) */
+#include "seg7.h"
+
+#define DISP_BASE      0x04000050u // first 7-segment display base adress (e)
+#define DISP_STRIDE    0x10u      // each next display is +0x10 (e)
+
+//Displays are in a contiguous block: display N is at DISP_BASE + N*DISP_STRIDE.
+
+
+   //(e) write raw values to a 7-segement display (active-low segments)
+
+void set_displays(int display_number, int value) { // (e)
+  if (display_number < 0 || display_number > 5) //display_number 0-5 selects which of the six 7-seg displays (e)
+     return;
+     //we compute it's adress:base+ index *stride (0x10) (e)
+  volatile unsigned int* disp = (volatile unsigned int*)(DISP_BASE + (unsigned)display_number * DISP_STRIDE);
+  *disp = (unsigned int)value; // we write value directly. On this board, writing 0 lights a segement (active-low) (e)
+  //this is a low level and  expects a segment pattern not a digit (e)
+  //What is value:
+  //It's an 8-bit pattern that tells the hardware which segments to light.
+  //What does active-low mean?:
+  //that an 0 bit means "turn this segment ON" and a 1 bit means "turn this segment OFF"
+}
+
+
+/* Font for ASCII 0x20..0x5f, lower case is shown as upper case. Active-high
+   here (1 = segment on) so the table reads like the usual 7-segment charts,
+   seg7_font inverts it. Letters like M, W and X can only be hinted at. */
+static const unsigned char font[64] = {
+  /*  ' '   '!'   '"'   '#'   '$'   '%'   '&'   '\'' */
+      0x00, 0x86, 0x22, 0x7e, 0x6d, 0x2d, 0x7d, 0x02,
+  /*  '('   ')'   '*'   '+'   ','   '-'   '.'   '/' */
+      0x39, 0x0f, 0x63, 0x46, 0x0c, 0x40, 0x80, 0x52,
+  /*  '0'   '1'   '2'   '3'   '4'   '5'   '6'   '7' */
+      0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07,
+  /*  '8'   '9'   ':'   ';'   '<'   '='   '>'   '?' */
+      0x7f, 0x6f, 0x09, 0x0d, 0x61, 0x48, 0x43, 0x53,
+  /*  '@'   'A'   'B'   'C'   'D'   'E'   'F'   'G' */
+      0x5f, 0x77, 0x7c, 0x39, 0x5e, 0x79, 0x71, 0x3d,
+  /*  'H'   'I'   'J'   'K'   'L'   'M'   'N'   'O' */
+      0x76, 0x30, 0x1e, 0x75, 0x38, 0x15, 0x54, 0x3f,
+  /*  'P'   'Q'   'R'   'S'   'T'   'U'   'V'   'W' */
+      0x73, 0x67, 0x50, 0x6d, 0x78, 0x3e, 0x1c, 0x2a,
+  /*  'X'   'Y'   'Z'   '['   '\'   ']'   '^'   '_' */
+      0x76, 0x6e, 0x5b, 0x39, 0x64, 0x0f, 0x23, 0x08,
+};
+
+/* What the program draws, and what the displays show. front starts with a
+   value no pattern has, so the first flush writes every digit. */
+static unsigned char back[SEG7_DIGITS];
+static unsigned short front[SEG7_DIGITS] = { 0x100, 0x100, 0x100, 0x100, 0x100, 0x100 };
+
+/* function: seg7_font
+   Description: The active-low pattern of character c, blank for characters
+   outside the font. The digits are the old SEG_DIGIT table. */
+unsigned char seg7_font(char c)
+{
+  unsigned char u = (unsigned char) c;
+  if (u >= 'a' && u <= 'z')
+    u -= 'a' - 'A';
+  if (u < 0x20 || u >= 0x60)
+    return 0xff;
+  return ~font[u - 0x20];
+}
+
+void seg7_raw(unsigned digit, unsigned char pattern)
+{
+  if (digit < SEG7_DIGITS)
+    back[digit] = pattern;
+}
+
+void seg7_putc(unsigned digit, char c)
+{
+  seg7_raw(digit, seg7_font(c));
+}
+
+/* function: seg7_flush
+   Description: Writes the digits that changed since the last flush to the
+   displays. When the clock ticks a second, usually only HEX0 is stored. */
+void seg7_flush(void)
+{
+  for (unsigned i = 0; i < SEG7_DIGITS; i++) {
+    if (back[i] != front[i]) {
+      front[i] = back[i];
+      set_displays(i, back[i]);
+    }
+  }
+}
+
+/* Marquee: the text enters at HEX0 and leaves past HEX5. After step pos the
+   window HEX5..HEX0 is text[pos - SEG7_DIGITS .. pos - 1], blank outside
+   the text. */
+static char marquee[SEG7_MARQUEE_MAX];
+static unsigned marquee_len;
+static unsigned marquee_pos;
+static int marquee_on;
+
+/* function: seg7_marquee
+   Description: Starts scrolling text (len characters, cut at
+   SEG7_MARQUEE_MAX), replacing a marquee that is still running. Nothing is
+   drawn until the first seg7_marquee_step. */
+void seg7_marquee(const char *text, unsigned len)
+{
+  if (len > SEG7_MARQUEE_MAX)
+    len = SEG7_MARQUEE_MAX;
+  for (unsigned i = 0; i < len; i++)
+    marquee[i] = text[i];
+  marquee_len = len;
+  marquee_pos = 1;
+  marquee_on = 1;
+}
+
+/* function: seg7_marquee_step
+   Description: Moves the marquee one digit to the left and draws it (the
+   flush is up to the caller). Returns 0 once the text has scrolled out,
+   from then on the displays are free for something else. */
+int seg7_marquee_step(void)
+{
+  if (!marquee_on)
+    return 0;
+  if (marquee_pos > marquee_len + SEG7_DIGITS) {
+    marquee_on = 0;
+    return 0;
+  }
+  for (unsigned i = 0; i < SEG7_DIGITS; i++) {
+    int at = (int) (marquee_pos + i) - SEG7_DIGITS;   /* shown on HEX(5 - i) */
+    char c = (at >= 0 && at < (int) marquee_len) ? marquee[at] : ' ';
+    back[SEG7_DIGITS - 1 - i] = seg7_font(c);
+  }
+  marquee_pos++;
+  return 1;
+}
+
+int seg7_marquee_busy(void)
+{
+  return marquee_on;
+}
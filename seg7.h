@@ -0,0 +1,26 @@
+#ifndef SEG7_H
+#define SEG7_H
+
+/* The six 7-segment displays through a framebuffer. Drawing only changes
+   the shadow copy; seg7_flush writes the digits that differ from what the
+   displays show, so an unchanged digit costs no MMIO store. Digit 0 is HEX0,
+   the rightmost one. Patterns are active-low like the hardware wants them
+   (a 0 bit lights the segment), bit 0 = a .. bit 6 = g, bit 7 = dp. */
+
+#define SEG7_DIGITS      6
+#define SEG7_MARQUEE_MAX 40    /* longest marquee text */
+
+void set_displays(int display_number, int value);
+
+unsigned char seg7_font(char c);
+void seg7_raw(unsigned digit, unsigned char pattern);
+void seg7_putc(unsigned digit, char c);
+void seg7_flush(void);
+
+/* Text scrolling in from the right and out to the left, one step per call
+   of seg7_marquee_step (from a timer-driven task) */
+void seg7_marquee(const char *text, unsigned len);
+int seg7_marquee_step(void);
+int seg7_marquee_busy(void);
+
+#endif
@@ -0,0 +1,128 @@
+#include "timer.h"
+#include "dtekv-lib.h"
+
+#define TIMER_BASE ((volatile unsigned int*) 0x04000020)
+#define TIMER_STATUS  (TIMER_BASE[0])   /* bit 0 TO: timeout happened, write 0 to clear */
+#define TIMER_CONTROL (TIMER_BASE[1])   /* bit 0 ITO, bit 1 CONT, bit 2 START, bit 3 STOP */
+#define TIMER_PERIODL (TIMER_BASE[2])
+#define TIMER_PERIODH (TIMER_BASE[3])
+#define TIMER_SNAPL   (TIMER_BASE[4])   /* write: latch the counter, read: its low half */
+#define TIMER_SNAPH   (TIMER_BASE[5])
+
+#define TIMER_ITO   0x1
+#define TIMER_CONT  0x2
+#define TIMER_START 0x4
+#define TIMER_STOP  0x8
+
+volatile unsigned timer_ticks = 0;
+static unsigned timer_period;      /* what timer_init loaded, in timer clocks - 1 */
+
+/* CPU cycles per millisecond, measured by timing_calibrate */
+unsigned cycles_per_ms = 0;
+
+#define CALIBRATE_MS 10
+
+/* function: timing_calibrate
+   Description: Runs the timer once for CALIBRATE_MS (polled, no interrupt)
+   and counts mcycle meanwhile. The timer runs off a known clock, mcycle runs
+   at whatever the CPU is clocked at, so this gives the CPU clock without
+   hardcoding it. Reprograms the timer, so timer_init must come after it
+   (timer_init calls it by itself if nobody has yet). */
+void timing_calibrate(void)
+{
+  unsigned period = CALIBRATE_MS * (TIMER_CLOCK_HZ / 1000u) - 1;
+
+  TIMER_CONTROL = TIMER_STOP;
+  TIMER_PERIODL = period & 0xffff;
+  TIMER_PERIODH = period >> 16;
+  TIMER_STATUS = 0;
+  TIMER_CONTROL = TIMER_START;         /* one shot, no interrupt */
+  unsigned t0 = read_mcycle();
+  while ((TIMER_STATUS & 1) == 0);
+  unsigned t1 = read_mcycle();
+  TIMER_STATUS = 0;
+
+  cycles_per_ms = (t1 - t0 + CALIBRATE_MS / 2) / CALIBRATE_MS;
+}
+
+/* now_us keeps a microsecond count and the mcycle value it corresponds to.
+   Only whole microseconds worth of cycles are consumed, the rest carries over
+   to the next call, so the count never drifts. mcycle is 32 bits, so now_us
+   must be called at least once per 2^32 cycles (143 s at 30 MHz). */
+static unsigned last_cycles;
+static unsigned us_count;
+
+unsigned now_us(void)
+{
+  if (cycles_per_ms == 0)
+    timing_calibrate();
+
+  unsigned st = irq_save();
+  unsigned delta = read_mcycle() - last_cycles;
+  unsigned ms = delta / cycles_per_ms;
+  unsigned rem = delta - ms * cycles_per_ms;
+  unsigned us = rem * 1000 / cycles_per_ms;     /* rem < cycles_per_ms, no overflow */
+
+  us_count += ms * 1000 + us;
+  last_cycles += ms * cycles_per_ms + us * cycles_per_ms / 1000;
+  unsigned result = us_count;
+  irq_restore(st);
+  return result;
+}
+
+/* Busy-wait; fine for up to 2^31 us. */
+void delay_us(unsigned us)
+{
+  unsigned start = now_us();
+  while (now_us() - start < us);
+}
+
+void delay_ms(unsigned ms)
+{
+  while (ms > 1000000) {
+    delay_us(1000000000);
+    ms -= 1000000;
+  }
+  delay_us(ms * 1000);
+}
+
+/* function: timer_init
+   Description: Starts the timer in continuous mode with an interrupt every
+   period_us microseconds, handled by handler. */
+void timer_init(unsigned period_us, irq_handler handler)
+{
+  if (cycles_per_ms == 0)
+    timing_calibrate();
+
+  unsigned period = period_us * (TIMER_CLOCK_HZ / 1000000u) - 1;
+
+  timer_period = period;
+  TIMER_CONTROL = TIMER_STOP;
+  TIMER_PERIODL = period & 0xffff;
+  TIMER_PERIODH = period >> 16;
+  TIMER_STATUS = 0;
+  TIMER_CONTROL = TIMER_ITO | TIMER_CONT | TIMER_START;
+
+  irq_register(TIMER_IRQ, handler);
+}
+
+/* function: timer_isr
+   Description: Acknowledges the timeout from the timer handler and returns
+   the new tick count, which callers use as a timestamp. */
+unsigned timer_isr(void)
+{
+  TIMER_STATUS = 0;
+  return ++timer_ticks;
+}
+
+/* function: timer_since_timeout
+   Description: Timer clocks since the last timeout. The counter runs down
+   from the period and is reloaded at the timeout, so a snapshot of it says
+   how long ago that was. Called first thing in the timer interrupt it is the
+   interrupt latency (plus the few instructions up to the snapshot). */
+unsigned timer_since_timeout(void)
+{
+  TIMER_SNAPL = 0;
+  unsigned left = TIMER_SNAPL | (TIMER_SNAPH << 16);
+  return timer_period - left;
+}
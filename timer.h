@@ -0,0 +1,23 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "irq.h"
+
+/* DTEK-V interval timer (Altera Avalon timer core) */
+#define TIMER_IRQ      16          /* mcause of the timer interrupt */
+#define TIMER_CLOCK_HZ 30000000u   /* the timer counts the 30 MHz system clock */
+
+extern volatile unsigned timer_ticks;   /* timer interrupts since timer_init */
+
+void timer_init(unsigned period_us, irq_handler handler);
+unsigned timer_isr(void);
+unsigned timer_since_timeout(void);
+
+/* mcycle based time, calibrated once against the timer */
+extern unsigned cycles_per_ms;
+void timing_calibrate(void);
+unsigned now_us(void);
+void delay_us(unsigned us);
+void delay_ms(unsigned ms);
+
+#endif
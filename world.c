@@ -0,0 +1,194 @@
+#include "world.h"
+
+#define DARK_ZONE 13   /* rooms in a dark zone: a room and up to two steps out */
+
+/* xorshift32: the same seed always gives the same world */
+static uint32_t rng;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static unsigned random_below(unsigned n)
+{
+  return (unsigned) (((uint64_t) next_random() * n) >> 32);   /* mulhu, no division */
+}
+
+/* The rooms sit on a grid `width` rooms wide, room i in column i % width and
+   row i / width. Only grid neighbours get connected, so every exit has a way
+   back: north/south and east/west are opposite directions (dir ^ 1). */
+static unsigned width;
+
+static int grid_neighbour(unsigned n, unsigned room, unsigned dir)
+{
+  switch (dir) {
+  case 0:  return room >= width ? (int) (room - width) : -1;
+  case 1:  return room + width < n ? (int) (room + width) : -1;
+  case 2:  return room % width + 1 < width && room + 1 < n ? (int) (room + 1) : -1;
+  default: return room % width != 0 ? (int) (room - 1) : -1;
+  }
+}
+
+static void connect(struct world *w, unsigned room, unsigned dir, int to)
+{
+  w->exits[room][dir] = to;
+  w->exits[to][dir ^ 1] = room;
+}
+
+static void clear_bits(uint32_t *set, unsigned n)
+{
+  for (unsigned i = 0; i < WORLD_BITSET_WORDS(n); i++)
+    set[i] = 0;
+}
+
+static void set_bit(uint32_t *set, unsigned room)
+{
+  set[room >> 5] |= 1u << (room & 31);
+}
+
+/* BFS from `from` that never enters a room in b1 or b2 (either may be 0).
+   order[] gets the rooms in the order they were reached, dist[] their
+   distance or -1. Returns the number of rooms reached. */
+static unsigned bfs(const struct world *w, unsigned from, const uint32_t *b1, const uint32_t *b2,
+                    int16_t *order, int16_t *dist)
+{
+  unsigned head = 0, tail = 0;
+
+  for (unsigned i = 0; i < w->num_rooms; i++)
+    dist[i] = -1;
+  dist[from] = 0;
+  order[tail++] = from;
+  while (head != tail) {
+    unsigned room = order[head++];
+    for (unsigned d = 0; d < 4; d++) {
+      int to = w->exits[room][d];
+      if (to < 0 || dist[to] >= 0)
+        continue;
+      if ((b1 && WORLD_HAS(b1, to)) || (b2 && WORLD_HAS(b2, to)))
+        continue;
+      dist[to] = dist[room] + 1;
+      order[tail++] = to;
+    }
+  }
+  return tail;
+}
+
+/* Random maze over the grid (depth-first backtracker, so every room is
+   reachable), then one extra door in about every eighth room for loops.
+   The dark bitset doubles as the visited set and is cleared afterwards. */
+static void make_maze(struct world *w, int16_t *stack)
+{
+  unsigned n = w->num_rooms, sp = 0;
+  uint32_t *visited = w->dark;
+
+  for (unsigned i = 0; i < n; i++)
+    w->exits[i][0] = w->exits[i][1] = w->exits[i][2] = w->exits[i][3] = -1;
+  clear_bits(visited, n);
+
+  stack[sp++] = 0;
+  set_bit(visited, 0);
+  while (sp != 0) {
+    unsigned room = stack[sp - 1], free_dirs[4], count = 0;
+    for (unsigned d = 0; d < 4; d++) {
+      int to = grid_neighbour(n, room, d);
+      if (to >= 0 && !WORLD_HAS(visited, to))
+        free_dirs[count++] = d;
+    }
+    if (count == 0) {
+      sp--;
+      continue;
+    }
+    unsigned d = free_dirs[random_below(count)];
+    int to = grid_neighbour(n, room, d);
+    connect(w, room, d, to);
+    set_bit(visited, to);
+    stack[sp++] = to;
+  }
+
+  for (unsigned room = 0; room < n; room++) {
+    if ((next_random() & 7) != 0)
+      continue;
+    unsigned d = next_random() & 3;
+    int to = grid_neighbour(n, room, d);
+    if (to >= 0 && w->exits[room][d] < 0)
+      connect(w, room, d, to);
+  }
+  clear_bits(visited, n);
+}
+
+/* function: world_generate
+   Description: Builds a world of w->num_rooms rooms with w->num_keys locked
+   doors, that can always be won:
+   - the goal is the room farthest from the start, and it is the last lock
+   - every key lies where it can be reached with the doors before it open
+     and its own door and all later ones still locked
+   - dark zones (a room and what is around it) cover a few percent of the
+     rooms, and the light lies where it can be reached without entering any
+     of them or any locked room */
+void world_generate(struct world *w, int16_t *scratch, unsigned seed)
+{
+  unsigned n = w->num_rooms, keys = w->num_keys;
+  int16_t *order = scratch, *dist = scratch + n;
+  int16_t around[DARK_ZONE];
+
+  if (keys > WORLD_MAX_KEYS) keys = WORLD_MAX_KEYS;
+  if (keys > n - 1) keys = n - 1;
+  w->num_keys = keys;
+  rng = seed ? seed : 1;
+  for (width = 1; width * width < n; width++)
+    ;
+
+  make_maze(w, order);
+  w->start = 0;
+  w->goal = order[bfs(w, 0, 0, 0, order, dist) - 1];
+
+  /* locked doors: the goal plus random rooms, sorted by distance from the start */
+  clear_bits(w->locked, n);
+  for (unsigned k = 0; k < keys; k++) {
+    unsigned door = w->goal;
+    if (k != 0) {
+      do {
+        door = 1 + random_below(n - 1);
+      } while (WORLD_HAS(w->locked, door));
+    }
+    set_bit(w->locked, door);
+    unsigned i = k;
+    for (; i > 0 && dist[w->key_door[i - 1]] > dist[door]; i--)
+      w->key_door[i] = w->key_door[i - 1];
+    w->key_door[i] = door;
+  }
+
+  /* dark zones around random rooms, never the start */
+  clear_bits(w->dark, n);
+  for (unsigned z = 0; z < n / 128 + 1; z++) {
+    unsigned center = random_below(n), count = 0;
+    around[count++] = center;
+    set_bit(w->dark, center);
+    for (unsigned i = 0; i < count && count < DARK_ZONE; i++) {
+      for (unsigned d = 0; d < 4 && count < DARK_ZONE; d++) {
+        int to = w->exits[around[i]][d];
+        if (to >= 0 && !WORLD_HAS(w->dark, to)) {   /* each room once, also in small worlds */
+          set_bit(w->dark, to);
+          around[count++] = to;
+        }
+      }
+    }
+  }
+  w->dark[0] &= ~1u;
+
+  unsigned reached = bfs(w, w->start, w->locked, w->dark, order, dist);
+  w->light_room = order[random_below(reached)];
+
+  /* keys, opening the doors one by one from the nearest */
+  for (unsigned k = 0; k < keys; k++) {
+    reached = bfs(w, w->start, w->locked, 0, order, dist);
+    w->key_room[k] = order[random_below(reached)];
+    w->locked[w->key_door[k] >> 5] &= ~(1u << (w->key_door[k] & 31));
+  }
+  for (unsigned k = 0; k < keys; k++)
+    set_bit(w->locked, w->key_door[k]);
+}
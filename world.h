@@ -0,0 +1,35 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdint.h>
+
+/* Procedurally generated worlds, stored as structure-of-arrays: the map is
+   one int16_t[4] per room (8 bytes, the same layout as room_exits in
+   labmain.c) and every per-room flag is a bitset. No text: a generated
+   room is only a number. The storage belongs to the caller, so nothing
+   here costs RAM in images that don't generate worlds. */
+
+#define WORLD_MAX_ROOMS 32767  /* room numbers must fit an int16_t */
+#define WORLD_MAX_KEYS  31     /* keys + the light fit a 32-bit item mask */
+
+#define WORLD_BITSET_WORDS(n) (((n) + 31) / 32)
+#define WORLD_HAS(set, room) (((set)[(room) >> 5] >> ((room) & 31)) & 1)
+
+struct world {
+  unsigned num_rooms;          /* set by the caller */
+  unsigned num_keys;           /* set by the caller, locked doors = keys */
+  int16_t (*exits)[4];         /* exits[room][dir], -1 = none, dir 0 north .. 3 west */
+  uint32_t *dark;              /* bitset, can't be entered without the light */
+  uint32_t *locked;            /* bitset, locked at the start */
+
+  unsigned start;
+  unsigned goal;               /* the room farthest from start, always locked if there are keys */
+  unsigned light_room;         /* where the light lies */
+  int16_t key_room[WORLD_MAX_KEYS];   /* where key k lies */
+  int16_t key_door[WORLD_MAX_KEYS];   /* the locked room key k opens */
+};
+
+/* scratch: 2 * num_rooms int16_t the generator may use (BFS order and distances) */
+void world_generate(struct world *w, int16_t *scratch, unsigned seed);
+
+#endif
@@ -0,0 +1,248 @@
+/* worldbench.c - generated-world benchmark: structure-of-arrays rooms vs the
+   old array of struct room, and routing (route.c) on a generated world.
+   Board: "make worldbench" and run main.bin (polled output, no interrupts).
+   Host:  "make worldbench-host" and run ./worldbench-host, times are in ns.
+   A world of WORLD_BENCH_ROOMS rooms is generated, copied into the old layout
+   and both are walked with the same random moves. The final rooms must match.
+   Then a world of ROUTE_BENCH_ROOMS rooms is routed, see route_bench. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dtekv-lib.h"
+#include "world.h"
+#include "route.h"
+
+#define WORLD_BENCH_ROOMS 16384
+#define WORLD_BENCH_KEYS  16
+#define WORLD_BENCH_MOVES 1000000   /* multiple of 1000 */
+#define WORLD_BENCH_SEED  12345
+#define ROUTE_BENCH_ROOMS 4096      /* 6 MiB of routes, make worldbench builds route.c for it */
+
+#if ROUTE_MAX_ROOMS < ROUTE_BENCH_ROOMS
+#error "build route.c with -DROUTE_MAX_ROOMS=4096 or more (make worldbench / worldbench-host do)"
+#endif
+
+/* The new layout: 8 bytes of exits per room and two bits */
+static int16_t exits[WORLD_BENCH_ROOMS][4];
+static uint32_t dark[WORLD_BITSET_WORDS(WORLD_BENCH_ROOMS)];
+static uint32_t locked[WORLD_BITSET_WORDS(WORLD_BENCH_ROOMS)];
+static int16_t scratch[2 * WORLD_BENCH_ROOMS];
+static struct world world;
+
+/* The old layout, struct room as labmain.c first had it: text pointers,
+   four int exits and one bool per flag and item, interleaved per room */
+struct old_room {
+  char *name;
+  char *desc;
+  int north;
+  int south;
+  int east;
+  int west;
+  bool dark;
+  bool locked;
+  char *lock_msg;
+  bool item_flashlight;
+  bool item_silver_key;
+  bool item_brass_key;
+};
+
+static struct old_room old_rooms[WORLD_BENCH_ROOMS];
+
+static void make_old_rooms(void)
+{
+  for (unsigned i = 0; i < world.num_rooms; i++) {
+    struct old_room *r = &old_rooms[i];
+    r->name = "Room";
+    r->desc = "A generated room.";
+    r->north = exits[i][0];
+    r->south = exits[i][1];
+    r->east = exits[i][2];
+    r->west = exits[i][3];
+    r->dark = WORLD_HAS(dark, i);
+    r->locked = WORLD_HAS(locked, i);
+    r->lock_msg = r->locked ? "Locked." : 0;
+    r->item_flashlight = world.light_room == i;
+    r->item_silver_key = r->item_brass_key = 0;
+  }
+}
+
+/* A move is what handle_go and can_enter do without the printing: look up
+   the exit, refuse locked rooms and dark rooms (the light is off). */
+static unsigned walk_new(unsigned moves)
+{
+  unsigned room = world.start;
+  uint32_t x = WORLD_BENCH_SEED;
+
+  for (unsigned i = 0; i < moves; i++) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    int to = exits[room][x & 3];
+    if (to < 0 || WORLD_HAS(locked, to) || WORLD_HAS(dark, to))
+      continue;
+    room = to;
+  }
+  return room;
+}
+
+static unsigned walk_old(unsigned moves)
+{
+  unsigned room = world.start;
+  uint32_t x = WORLD_BENCH_SEED;
+
+  for (unsigned i = 0; i < moves; i++) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    const struct old_room *cur = &old_rooms[room];
+    unsigned dir = x & 3;
+    int to = -1;
+    if (dir == 0) to = cur->north;
+    if (dir == 1) to = cur->south;
+    if (dir == 2) to = cur->east;
+    if (dir == 3) to = cur->west;
+    if (to == -1 || old_rooms[to].locked || old_rooms[to].dark)
+      continue;
+    room = to;
+  }
+  return room;
+}
+
+/* x / 100 with two decimals */
+static void print_hundredths(unsigned x)
+{
+  print_dec(x / 100);
+  printc('.');
+  print_dec_pad(x % 100, 2, '0');
+}
+
+static void report(char *name, unsigned ticks, unsigned bytes)
+{
+  unsigned per_k = ticks / (WORLD_BENCH_MOVES / 1000);   /* time of 1000 moves */
+  if (per_k == 0) per_k = 1;
+
+  print(name);
+  print_hundredths(bytes * 100 / world.num_rooms);
+  print(" bytes/room, ");
+  print_hundredths(per_k / 10);
+  print(" " MCYCLE_UNIT "/move, ");
+  print_dec(MCYCLE_HZ / per_k * 1000 + MCYCLE_HZ % per_k * 1000 / per_k);
+  print(" moves/s\n");
+}
+
+/* Routing as the travel command uses it, on a generated world: route_init
+   (one BFS per destination), then the locked doors are opened one by one
+   and after each one the player travels to the door just opened. A row is
+   only rebuilt when it is asked for, so that costs one row; asking for every
+   destination at the end rebuilds all rows the unlocks made dirty. Dark
+   rooms stay blocked, the light is never switched on. */
+static uint32_t route_blocked[WORLD_BITSET_WORDS(ROUTE_BENCH_ROOMS)];
+
+static unsigned reachable_from_start(void)
+{
+  unsigned n = 0;
+  for (unsigned to = 0; to < world.num_rooms; to++)
+    n += route_next(world.start, to) != ROUTE_NONE;
+  return n;
+}
+
+static void print_rows(unsigned ticks, unsigned rows)
+{
+  print_dec(ticks);
+  print(" " MCYCLE_UNIT ", ");
+  print_dec(rows);
+  print(" rows built\n");
+}
+
+static void route_bench(void)
+{
+  world.num_rooms = ROUTE_BENCH_ROOMS;
+  world_generate(&world, scratch, WORLD_BENCH_SEED);
+  for (unsigned i = 0; i < WORLD_BITSET_WORDS(ROUTE_BENCH_ROOMS); i++)
+    route_blocked[i] = locked[i] | dark[i];
+
+  print("\n== routing, ");
+  print_dec(world.num_rooms);
+  print(" rooms ==\n");
+  unsigned t0 = read_mcycle();
+  if (!route_init(world.num_rooms, exits, route_blocked)) {
+    print("route_init refused the world\n");
+    return;
+  }
+  unsigned t1 = read_mcycle();
+  unsigned rows = route_rebuilds();
+  print("route_init:                      ");
+  print_rows(t1 - t0, rows);
+  unsigned before = reachable_from_start();
+
+  t0 = read_mcycle();
+  for (unsigned k = 0; k < world.num_keys; k++) {
+    route_set_blocked(world.key_door[k], 0);
+    route_next(world.start, world.key_door[k]);
+  }
+  t1 = read_mcycle();
+  print_dec(world.num_keys);
+  print(" doors opened, travel to each: ");
+  print_rows(t1 - t0, route_rebuilds() - rows);
+  rows = route_rebuilds();
+
+  t0 = read_mcycle();
+  unsigned after = reachable_from_start();
+  t1 = read_mcycle();
+  print("then travel to every room:       ");
+  print_rows(t1 - t0, route_rebuilds() - rows);
+
+  print("rooms reachable from the start: ");
+  print_dec(before);
+  print(" with every door locked, ");
+  print_dec(after);
+  print(" with every door open\n");
+}
+
+int main(void)
+{
+  world.num_rooms = WORLD_BENCH_ROOMS;
+  world.num_keys = WORLD_BENCH_KEYS;
+  world.exits = exits;
+  world.dark = dark;
+  world.locked = locked;
+
+  unsigned t0 = read_mcycle();
+  world_generate(&world, scratch, WORLD_BENCH_SEED);
+  unsigned gen = read_mcycle() - t0;
+  make_old_rooms();
+
+  unsigned n_dark = 0;
+  for (unsigned i = 0; i < world.num_rooms; i++)
+    n_dark += WORLD_HAS(dark, i);
+
+  print("\n== generated world ==\n");
+  print_dec(world.num_rooms);
+  print(" rooms, ");
+  print_dec(world.num_keys);
+  print(" locked doors, ");
+  print_dec(n_dark);
+  print(" dark rooms, goal room ");
+  print_dec(world.goal);
+  print(", generated in ");
+  print_dec(gen);
+  print(" " MCYCLE_UNIT "\n");
+
+  t0 = read_mcycle();
+  unsigned end_new = walk_new(WORLD_BENCH_MOVES);
+  unsigned t1 = read_mcycle();
+  unsigned end_old = walk_old(WORLD_BENCH_MOVES);
+  unsigned t2 = read_mcycle();
+
+  print("\n");
+  print_dec(WORLD_BENCH_MOVES);
+  print(" random moves, both walks end in room ");
+  print_dec(end_new);
+  if (end_new != end_old) {
+    print(" / ");
+    print_dec(end_old);
+    print(" MISMATCH");
+  }
+  print("\n");
+  report("SoA exits + bitsets:  ", t1 - t0, sizeof(exits[0]) * world.num_rooms + 2 * 4 * WORLD_BITSET_WORDS(world.num_rooms));
+  report("array of struct room: ", t2 - t1, sizeof(old_rooms[0]) * world.num_rooms);
+
+  route_bench();
+  return 0;
+}